@@ -0,0 +1,317 @@
+/*
+
+Module: cFlashLog.cpp
+
+Function:
+    Measurement log in the SPI flash, for SDP demo.
+
+Copyright:
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include "cFlashLog.h"
+
+#include <MCCI_Catena_SDP_Crc.h>
+
+using namespace McciCatena;
+using namespace McciCatenaSdp;
+
+/****************************************************************************\
+|
+|   Slot encoding: all fields big-endian; the last byte is the CRC of the
+|   others. Unused bytes are left erased (0xFF).
+|
+\****************************************************************************/
+
+static std::uint8_t *putBE(std::uint8_t *p, std::uint32_t v, unsigned nBytes)
+    {
+    for (unsigned i = nBytes; i > 0; --i)
+        *p++ = std::uint8_t(v >> (8 * (i - 1)));
+    return p;
+    }
+
+static std::uint32_t getBE(const std::uint8_t *&p, unsigned nBytes)
+    {
+    std::uint32_t v = 0;
+
+    for (unsigned i = 0; i < nBytes; ++i)
+        v = (v << 8) | *p++;
+    return v;
+    }
+
+bool cFlashLog::readSlot(std::uint32_t iSector, std::uint32_t iSlot, std::uint8_t (&slot)[kSlotSize])
+    {
+    this->m_flash.read(this->getSlotAddress(iSector, iSlot), slot, kSlotSize);
+    return cCrc8::crc(slot, kSlotSize - 1) == slot[kSlotSize - 1];
+    }
+
+bool cFlashLog::isSlotErased(std::uint32_t iSector, std::uint32_t iSlot)
+    {
+    std::uint8_t slot[kSlotSize];
+
+    this->m_flash.read(this->getSlotAddress(iSector, iSlot), slot, kSlotSize);
+    for (auto b : slot)
+        {
+        if (b != 0xFF)
+            return false;
+        }
+    return true;
+    }
+
+// program a slot, and check it by reading it back.
+bool cFlashLog::writeSlot(std::uint32_t iSector, std::uint32_t iSlot, std::uint8_t (&slot)[kSlotSize])
+    {
+    std::uint8_t check[kSlotSize];
+
+    slot[kSlotSize - 1] = cCrc8::crc(slot, kSlotSize - 1);
+    this->m_flash.program(this->getSlotAddress(iSector, iSlot), slot, kSlotSize);
+    this->m_flash.read(this->getSlotAddress(iSector, iSlot), check, kSlotSize);
+
+    for (std::size_t i = 0; i < kSlotSize; ++i)
+        {
+        if (check[i] != slot[i])
+            return false;
+        }
+    return true;
+    }
+
+bool cFlashLog::readHeader(std::uint32_t iSector, SectorHeader &h)
+    {
+    std::uint8_t slot[kSlotSize];
+
+    if (! this->readSlot(iSector, 0, slot))
+        return false;
+
+    const std::uint8_t *p = slot;
+
+    if (getBE(p, 4) != kMagic || getBE(p, 1) != kSlotSize)
+        return false;
+
+    h.SectorSeq = getBE(p, 4);
+    h.FirstRecordSeq = getBE(p, 4);
+    return true;
+    }
+
+/****************************************************************************\
+|
+|   The log
+|
+\****************************************************************************/
+
+bool cFlashLog::begin()
+    {
+    this->m_fReady = false;
+    if (this->m_nSectors < 2)
+        return false;
+
+    // find the newest and oldest sectors from their headers.
+    bool fFound = false;
+    std::uint32_t oldestFirstSeq = 0;
+
+    this->m_flash.powerUp();
+    for (std::uint32_t iSector = 0; iSector < this->m_nSectors; ++iSector)
+        {
+        SectorHeader h;
+
+        if (! this->readHeader(iSector, h))
+            continue;
+
+        if (! fFound || std::int32_t(h.SectorSeq - this->m_headSectorSeq) > 0)
+            {
+            this->m_headSector = iSector;
+            this->m_headSectorSeq = h.SectorSeq;
+            this->m_headFirstSeq = h.FirstRecordSeq;
+            }
+        if (! fFound || std::int32_t(h.FirstRecordSeq - oldestFirstSeq) < 0)
+            oldestFirstSeq = h.FirstRecordSeq;
+        fFound = true;
+        }
+
+    this->m_fEmpty = ! fFound;
+    if (! fFound)
+        {
+        this->m_nextSlot = kSlotsPerSector;
+        this->m_firstSeq = this->m_nextSeq = 0;
+        }
+    else
+        {
+        // slots are written in order, so the written ones come first;
+        // a slot damaged by a power failure counts as written.
+        std::uint32_t lo = 1;
+        std::uint32_t hi = kSlotsPerSector;
+
+        while (lo < hi)
+            {
+            const std::uint32_t mid = lo + (hi - lo) / 2;
+
+            if (this->isSlotErased(this->m_headSector, mid))
+                hi = mid;
+            else
+                lo = mid + 1;
+            }
+
+        this->m_nextSlot = lo;
+        this->m_nextSeq = this->m_headFirstSeq + (lo - 1);
+        this->m_firstSeq = oldestFirstSeq;
+        this->updateFirstSequence();
+        }
+    this->m_flash.powerDown();
+
+    this->m_fReady = true;
+    return true;
+    }
+
+// every sector but the head is full, so at most m_nSectors - 1 sectors of
+// records come before the head.
+void cFlashLog::updateFirstSequence()
+    {
+    const std::uint32_t nBefore = (this->m_nSectors - 1) * kRecordsPerSector;
+
+    if (this->m_headFirstSeq - this->m_firstSeq > nBefore)
+        this->m_firstSeq = this->m_headFirstSeq - nBefore;
+    }
+
+// erase the next sector and write its header. If power fails before the
+// header is written, the sector is ignored, and erased again next time.
+bool cFlashLog::startSector()
+    {
+    const std::uint32_t iSector = this->m_fEmpty ? 0 : (this->m_headSector + 1) % this->m_nSectors;
+    const std::uint32_t sectorSeq = this->m_fEmpty ? 0 : this->m_headSectorSeq + 1;
+    std::uint8_t slot[kSlotSize];
+
+    if (! this->m_flash.eraseSector(this->getSlotAddress(iSector, 0)))
+        return false;
+
+    for (auto &b : slot)
+        b = 0xFF;
+
+    std::uint8_t *p = slot;
+
+    p = putBE(p, kMagic, 4);
+    p = putBE(p, kSlotSize, 1);
+    p = putBE(p, sectorSeq, 4);
+    p = putBE(p, this->m_nextSeq, 4);
+
+    if (! this->writeSlot(iSector, 0, slot))
+        return false;
+
+    if (this->m_fEmpty)
+        this->m_firstSeq = this->m_nextSeq;
+    this->m_fEmpty = false;
+    this->m_headSector = iSector;
+    this->m_headSectorSeq = sectorSeq;
+    this->m_headFirstSeq = this->m_nextSeq;
+    this->m_nextSlot = 1;
+    this->updateFirstSequence();
+    return true;
+    }
+
+bool cFlashLog::append(Record &r)
+    {
+    if (! this->m_fReady)
+        return false;
+
+    bool fResult = true;
+
+    this->m_flash.powerUp();
+    if (this->m_nextSlot >= kSlotsPerSector)
+        fResult = this->startSector();
+
+    if (fResult)
+        {
+        std::uint8_t slot[kSlotSize];
+
+        for (auto &b : slot)
+            b = 0xFF;
+
+        r.Sequence = this->m_nextSeq;
+
+        std::uint8_t *p = slot;
+
+        p = putBE(p, r.Sequence, 4);
+        p = putBE(p, r.BootCount, 4);
+        p = putBE(p, r.Seconds, 4);
+        p = putBE(p, std::uint32_t(r.DpMeanMilliPa), 4);
+        p = putBE(p, std::uint32_t(r.DpMinMilliPa), 4);
+        p = putBE(p, std::uint32_t(r.DpMaxMilliPa), 4);
+        p = putBE(p, std::uint32_t(r.TMeanMilliC), 4);
+        p = putBE(p, r.nSamples, 1);
+
+        // the slot is used even if the write fails.
+        fResult = this->writeSlot(this->m_headSector, this->m_nextSlot, slot);
+        ++this->m_nextSlot;
+        ++this->m_nextSeq;
+        }
+    this->m_flash.powerDown();
+
+    return fResult;
+    }
+
+bool cFlashLog::read(std::uint32_t sequence, Record &r)
+    {
+    if (! this->m_fReady ||
+        sequence - this->m_firstSeq >= this->m_nextSeq - this->m_firstSeq)
+        return false;
+
+    // find the sector counting back from the head.
+    std::uint32_t iSector = this->m_headSector;
+    std::uint32_t firstSeq = this->m_headFirstSeq;
+
+    if (std::int32_t(sequence - firstSeq) < 0)
+        {
+        const std::uint32_t nBack = (firstSeq - sequence - 1) / kRecordsPerSector + 1;
+
+        iSector = (iSector + this->m_nSectors - nBack % this->m_nSectors) % this->m_nSectors;
+        firstSeq -= nBack * kRecordsPerSector;
+        }
+
+    std::uint8_t slot[kSlotSize];
+    bool fResult;
+
+    this->m_flash.powerUp();
+    fResult = this->readSlot(iSector, 1 + (sequence - firstSeq), slot);
+    this->m_flash.powerDown();
+
+    if (! fResult)
+        return false;
+
+    const std::uint8_t *p = slot;
+
+    r.Sequence = getBE(p, 4);
+    r.BootCount = getBE(p, 4);
+    r.Seconds = getBE(p, 4);
+    r.DpMeanMilliPa = std::int32_t(getBE(p, 4));
+    r.DpMinMilliPa = std::int32_t(getBE(p, 4));
+    r.DpMaxMilliPa = std::int32_t(getBE(p, 4));
+    r.TMeanMilliC = std::int32_t(getBE(p, 4));
+    r.nSamples = std::uint8_t(getBE(p, 1));
+
+    return r.Sequence == sequence;
+    }
+
+// sectors are always erased before they're reused, so it's enough to
+// erase the ones with headers.
+bool cFlashLog::erase()
+    {
+    if (! this->m_fReady)
+        return false;
+
+    bool fResult = true;
+
+    this->m_flash.powerUp();
+    for (std::uint32_t iSector = 0; iSector < this->m_nSectors; ++iSector)
+        {
+        if (! this->isSlotErased(iSector, 0))
+            fResult &= this->m_flash.eraseSector(this->getSlotAddress(iSector, 0));
+        }
+    this->m_flash.powerDown();
+
+    this->m_fEmpty = true;
+    this->m_nextSlot = kSlotsPerSector;
+    this->m_firstSeq = this->m_nextSeq = 0;
+    return fResult;
+    }
@@ -0,0 +1,161 @@
+/*
+
+Module:	cFlashLog.h
+
+Function:
+	Measurement log in the SPI flash, for SDP demo
+
+Copyright and License:
+	This file copyright (C) 2020 by
+
+		MCCI Corporation
+		3520 Krums Corners Road
+		Ithaca, NY  14850
+
+	See accompanying LICENSE file for copyright and license information.
+
+Author:
+	Terry Moore, MCCI Corporation	September 2020
+
+*/
+
+#ifndef _cFlashLog_h_
+#define _cFlashLog_h_	/* prevent multiple includes */
+
+#pragma once
+
+#include <Catena_Mx25v8035f.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/****************************************************************************\
+|
+|   An append-only ring of measurement records in the flash
+|
+\****************************************************************************/
+
+// The log occupies a range of flash sectors, used in turn, so that each
+// sector is erased once per trip around the ring. The first slot of each
+// sector is a header giving the sector's sequence number and the sequence
+// number of its first record; the other slots hold fixed-size records, in
+// order. Each slot ends with a CRC.
+//
+// Records are written in order, and a sector is erased just before it's
+// reused, so a power failure loses at most the record or sector header
+// being written. On startup, begin() reads the sector headers to find the
+// newest sector, then finds the first empty slot in that sector by binary
+// search; it doesn't scan the records.
+class cFlashLog
+    {
+public:
+    // by default, the log uses the upper half of the flash.
+    static constexpr std::uint32_t kDefaultBase = McciCatena::Catena_Mx25v8035f::CHIP_SIZE / 2;
+    static constexpr std::uint32_t kDefaultSectors =
+        McciCatena::Catena_Mx25v8035f::CHIP_SIZE / 2 / McciCatena::Catena_Mx25v8035f::SECTOR_SIZE;
+
+    static constexpr std::size_t kSlotSize = 32;
+    static constexpr std::uint32_t kSlotsPerSector = McciCatena::Catena_Mx25v8035f::SECTOR_SIZE / kSlotSize;
+    static constexpr std::uint32_t kRecordsPerSector = kSlotsPerSector - 1;
+
+    // one measurement: the summary of a burst.
+    struct Record
+        {
+        std::uint32_t Sequence;         /// set by append()
+        std::uint32_t BootCount;        /// boot count when recorded
+        std::uint32_t Seconds;          /// seconds since boot
+        std::int32_t DpMeanMilliPa;     /// mean DP
+        std::int32_t DpMinMilliPa;      /// minimum DP
+        std::int32_t DpMaxMilliPa;      /// maximum DP
+        std::int32_t TMeanMilliC;       /// mean temperature
+        std::uint8_t nSamples;          /// number of readings
+        };
+
+    cFlashLog(
+        McciCatena::Catena_Mx25v8035f &flash,
+        std::uint32_t base = kDefaultBase,
+        std::uint32_t nSectors = kDefaultSectors
+        )
+        : m_flash(flash)
+        , m_base(base)
+        , m_nSectors(nSectors)
+        {}
+
+    // neither copyable nor movable
+    cFlashLog(const cFlashLog&) = delete;
+    cFlashLog& operator=(const cFlashLog&) = delete;
+    cFlashLog(const cFlashLog&&) = delete;
+    cFlashLog& operator=(const cFlashLog&&) = delete;
+
+    // find the end of the log. The flash must have been started with
+    // begin(); it's left powered down. Returns false if the log can't
+    // be used (fewer than two sectors).
+    bool begin();
+    bool isReady() const
+        {
+        return this->m_fReady;
+        }
+
+    // add a record, setting r.Sequence. Returns false if the log isn't
+    // ready, or the record didn't read back correctly.
+    bool append(Record &r);
+
+    // read the record with the given sequence number. Returns false if
+    // it's been overwritten, hasn't been written, or is damaged.
+    bool read(std::uint32_t sequence, Record &r);
+
+    // the oldest record in the log, and the sequence number of the next
+    // record to be written; the log is empty if they're the same.
+    std::uint32_t getFirstSequence() const
+        {
+        return this->m_firstSeq;
+        }
+    std::uint32_t getNextSequence() const
+        {
+        return this->m_nextSeq;
+        }
+    std::uint32_t getSectorCount() const
+        {
+        return this->m_nSectors;
+        }
+
+    // discard all records.
+    bool erase();
+
+private:
+    struct SectorHeader
+        {
+        std::uint32_t SectorSeq;        /// counts sectors started
+        std::uint32_t FirstRecordSeq;   /// sequence number of slot 1
+        };
+
+    static constexpr std::uint32_t kMagic = 0x53445031;     // "SDP1"
+
+    std::uint32_t getSlotAddress(std::uint32_t iSector, std::uint32_t iSlot) const
+        {
+        return this->m_base +
+               iSector * McciCatena::Catena_Mx25v8035f::SECTOR_SIZE +
+               iSlot * kSlotSize;
+        }
+
+    bool readSlot(std::uint32_t iSector, std::uint32_t iSlot, std::uint8_t (&slot)[kSlotSize]);
+    bool isSlotErased(std::uint32_t iSector, std::uint32_t iSlot);
+    bool writeSlot(std::uint32_t iSector, std::uint32_t iSlot, std::uint8_t (&slot)[kSlotSize]);
+    bool readHeader(std::uint32_t iSector, SectorHeader &h);
+    bool startSector();
+    void updateFirstSequence();
+
+    McciCatena::Catena_Mx25v8035f &m_flash;     /// the flash chip
+    std::uint32_t m_base;                       /// address of the first sector
+    std::uint32_t m_nSectors;                   /// number of sectors
+    std::uint32_t m_headSector = 0;             /// sector being written
+    std::uint32_t m_headSectorSeq = 0;          /// its sequence number
+    std::uint32_t m_headFirstSeq = 0;           /// sequence number of its first record
+    std::uint32_t m_nextSlot = kSlotsPerSector; /// next free slot in the head sector
+    std::uint32_t m_firstSeq = 0;               /// oldest record
+    std::uint32_t m_nextSeq = 0;                /// next record to write
+    bool m_fReady = false;                      /// begin() succeeded
+    bool m_fEmpty = true;                       /// no sector has been started
+    };
+
+#endif /* _cFlashLog_h_ */
@@ -46,7 +46,7 @@ void cMeasurementLoop::begin()
 
         gCatena.registerObject(this);
 
-        this->m_UplinkTimer.begin(this->m_txCycleSec * 1000);
+        this->m_UplinkTimer.begin(this->getCycleTime() * 1000);
         }
 
     if (! this->m_running)
@@ -164,50 +164,45 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
         if (fEntry)
             {
             this->setTimer(2 * 1000);
-            this->m_measurement_valid = false;
-            if (! this->m_Sdp.startTriggeredMeasurement())
+            if (! this->m_fWindowOpen)
                 {
-                if (gLog.isEnabled(gLog.DebugFlags::kError))
-                    gLog.printf(
-                        gLog.kAlways,
-                        "SDP startTriggeredMeasurement failed: status %s(%u)\n",
-                        this->m_Sdp.getLastErrorName(),
-                        unsigned(this->m_Sdp.getLastError())
-                        );
+                this->resetMeasurements();
+                this->m_fWindowOpen = true;
                 }
-            }
-        if (this->m_Sdp.queryReady())
-            {
-            this->clearTimer();
-            this->m_measurement_valid = this->m_Sdp.readMeasurement();
-            if ((! this->m_measurement_valid) && gLog.isEnabled(gLog.kError))
+            this->startBurst();
+            this->m_fMeasurementDone = false;
+            this->m_fMeasuring = true;
+
+            // the engine wakes the SDP, triggers, waits, reads and (after
+            // the last of the burst) puts it back to sleep, as we poll it.
+            if (! this->requestMeasurement())
                 {
-                gLog.printf(gLog.kAlways, "SDP measurement failed: error %s(%u)\n",
-                        this->m_Sdp.getLastErrorName(),
-                        unsigned(this->m_Sdp.getLastError())
-                    );
+                if (gLog.isEnabled(gLog.DebugFlags::kError))
+                    gLog.printf(gLog.kAlways, "SDP requestMeasurement failed\n");
+
+                this->m_fMeasuring = false;
+                newState = State::stSleepSensor;
+                break;
                 }
-            newState = State::stSleepSensor;
             }
-        else if (this->m_Sdp.getLastError() != cSDP::Error::Busy)
+        if (this->m_fMeasurementDone)
             {
-            if (gLog.isEnabled(gLog.DebugFlags::kError))
-                gLog.printf(
-                    gLog.kAlways,
-                    "SDP queryReady failed: status %s(%u)\n",
-                    this->m_Sdp.getLastErrorName(),
-                    unsigned(this->m_Sdp.getLastError())
-                    );
-
+            this->clearTimer();
+            this->m_fMeasuring = false;
             newState = State::stSleepSensor;
             }
         else if (this->timedOut())
             {
+            // send whatever we have.
             if (gLog.isEnabled(gLog.kError))
                 {
-                gLog.printf(gLog.kAlways, "SDP measurement timed out\n");
+                gLog.printf(gLog.kAlways, "SDP measurement timed out after %u samples\n",
+                    unsigned(this->m_BurstDpStats.getCount())
+                    );
                 }
 
+            this->m_SdpAsync.cancel();
+            this->m_fMeasuring = false;
             newState = State::stSleepSensor;
             }
         break;
@@ -227,7 +222,9 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
                 }
             }
 
-        newState = State::stTransmit;
+        this->m_lastBurstSec = this->getUptime();
+        this->logBurst();
+        newState = this->checkReport() ? State::stTransmit : State::stSleeping;
         break;
 
     case State::stTransmit:
@@ -240,12 +237,53 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
         if (this->txComplete())
             {
             newState = State::stSleeping;
+            this->m_fWindowOpen = false;
+
+            // keep the data of a failed uplink; after a good one, the
+            // network is back, so send some of the backlog.
+            if (this->m_txerr)
+                {
+                for (unsigned i = 0; i < this->m_nInFlight; ++i)
+                    this->addBacklog(this->m_inFlight[i]);
+
+                if (this->m_nInFlight != 0 && gLog.isEnabled(gLog.kInfo))
+                    gLog.printf(gLog.kAlways, "uplink failed: %u points kept for backfill\n",
+                        unsigned(this->m_nInFlight)
+                        );
+                }
+            else if (this->m_backfillLimit != 0 && this->hasBacklog())
+                newState = State::stBackfill;
 
             // calculate the new sleep interval.
             this->updateTxCycleTime();
             }
         break;
 
+    // send up to m_backfillLimit uplinks from the backlog, oldest first,
+    // stopping at the first failure.
+    case State::stBackfill:
+        if (fEntry)
+            {
+            this->m_nBackfillSent = 0;
+            if (! this->startBackfill())
+                {
+                newState = State::stSleeping;
+                break;
+                }
+            }
+        if (this->txComplete())
+            {
+            if (this->m_txerr)
+                newState = State::stSleeping;
+            else
+                {
+                this->commitBackfill();
+                if (++this->m_nBackfillSent >= this->m_backfillLimit || ! this->startBackfill())
+                    newState = State::stSleeping;
+                }
+            }
+        break;
+
     case State::stFinal:
         break;
 
@@ -265,78 +303,418 @@ cMeasurementLoop::State cMeasurementLoop::fsmDispatch(
 void cMeasurementLoop::fillTxBuffer(cMeasurementLoop::TxBuffer_t& b)
     {
     auto const savedLed = gLed.Set(McciCatena::LedPattern::Measuring);
+    const bool fSeries = this->m_messageFormat == kSeriesMessageFormat;
 
-    b.begin();
-    Flags flag;
+    // find the fields we could send.
+    Flags avail = Flags::Vbat;
 
-    flag = Flags(0);
+    uint32_t bootCount;
+    if (gCatena.getBootCount(bootCount))
+        avail |= Flags::Boot;
 
-    // insert format byte
-    b.put(kMessageFormat);
+    cSDP::Metrics metrics;
+    if (this->m_Sdp.getMetrics(metrics))
+        avail |= Flags::Diag;
 
-    // insert a byte that will become flags later.
-    std::uint8_t * const pFlag = b.getp();
+    if (fSeries)
+        {
+        if (this->m_TStats.getCount() != 0)
+            avail |= Flags::T;
+        }
+    else if (this->m_fDiffPressure && this->m_measurement_valid)
+        {
+        avail |= Flags::T | Flags::DP | Flags::Quantiles;
+        if (this->m_VolumeFlowStats.getCount() != 0)
+            avail |= Flags::Flow;
+        }
+
+    // choose the fields that fit in the largest payload allowed at the
+    // current data rate, most important first. The DP series comes first;
+    // samples that don't fit are kept for the next uplink.
+    const std::size_t nPayload = getMaxPayload();
+    std::size_t nFree = nPayload - 2;
+    std::uint8_t series[kTxBufferSize];
+    std::size_t nSeriesBytes = 0;
+    std::size_t nSeriesSent = 0;
+    Flags flag = Flags(0);
+
+    this->m_nInFlight = 0;
+    if (fSeries && this->m_fDiffPressure && this->m_nSeries != 0)
+        {
+        nSeriesBytes = this->encodeSeries(
+                            this->m_series, this->m_nSeries,
+                            this->m_reportConfig.SampleSec,
+                            this->getUptime() - this->m_seriesNewestSec,
+                            series, nFree, nSeriesSent
+                            );
+        if (nSeriesBytes != 0)
+            {
+            flag |= Flags::Series;
+            nFree -= nSeriesBytes;
+            }
+        }
+
+    static const struct
+        {
+        Flags flag;
+        std::uint8_t nBytes;
+        } kFields[] =
+        {
+        { Flags::DP, 9 },
+        { Flags::T, 2 },
+        { Flags::Vbat, 2 },
+        { Flags::Boot, 1 },
+        { Flags::Quantiles, 3 * kNumQuantiles },
+        { Flags::Flow, 8 },
+        { Flags::Diag, kDiagBytes },
+        };
+
+    for (auto const &field : kFields)
+        {
+        if (isSet(avail, field.flag) && ! isSet(flag, field.flag) && field.nBytes <= nFree)
+            {
+            flag |= field.flag;
+            nFree -= field.nBytes;
+            }
+        }
+
+    if (gLog.isEnabled(gLog.kInfo) && (std::uint8_t(avail) & ~std::uint8_t(flag)) != 0)
+        {
+        gCatena.SafePrintf(
+            "payload limit %u bytes: fields 0x%02x not sent\n",
+            unsigned(nPayload), unsigned(std::uint8_t(avail) & ~std::uint8_t(flag))
+            );
+        }
+
+    // now put the fields, in the order of their flag bits.
+    b.begin();
+    b.put(this->m_messageFormat);
     b.put(std::uint8_t(flag));
 
-    // send Vbat
-    float Vbat = gCatena.ReadVbat();
-    gCatena.SafePrintf("Vbat:    %d mV\n", (int) (Vbat * 1000.0f));
-    b.putV(Vbat);
-    flag |= Flags::Vbat;
+    if (isSet(flag, Flags::Vbat))
+        {
+        float Vbat = gCatena.ReadVbat();
+        gCatena.SafePrintf("Vbat:    %d mV\n", (int) (Vbat * 1000.0f));
+        b.putV(Vbat);
+        }
 
     // send Vdd if we can measure it.
 
-    // send boot count
-    uint32_t bootCount;
-    if (gCatena.getBootCount(bootCount))
-        {
+    if (isSet(flag, Flags::Boot))
         b.putBootCountLsb(bootCount);
-        flag |= Flags::Boot;
+
+    if (isSet(flag, Flags::T))
+        {
+        const std::int32_t tMean = this->m_TStats.getMean();
+
+        // put2 takes a unit32_t or int32_t; temperature is signed, so
+        // use the int32_t version. The units are 0.005 deg C.
+        b.put2(std::int32_t((tMean + (tMean < 0 ? -2 : 2)) / 5));
+        }
+
+    if (fSeries && isSet(flag, Flags::Series))
+        {
+        for (std::size_t i = 0; i < nSeriesBytes; ++i)
+            b.put(series[i]);
+
+        for (std::size_t i = 0; i < nSeriesSent; ++i)
+            this->m_inFlight[i] = this->getSeriesPoint(i);
+        this->m_nInFlight = std::uint8_t(nSeriesSent);
+
+        // keep the samples that didn't fit for the next uplink.
+        this->m_nSeries = std::uint8_t(this->m_nSeries - nSeriesSent);
+        for (std::size_t i = 0; i < this->m_nSeries; ++i)
+            this->m_series[i] = this->m_series[i + nSeriesSent];
+        }
+    else if (isSet(flag, Flags::DP))
+        {
+        this->putStatistics(b);
+        // the mean covers the whole window, not one burst, so it's not
+        // the value of any log record.
+        this->m_inFlight[0] = { this->m_lastLogSeq, this->m_lastBurstSec, this->m_DpStats.getMean(), false };
+        this->m_nInFlight = 1;
+        }
+
+    // send the driver's counters; then start a new interval. If they
+    // don't fit, they keep counting until the next uplink.
+    if (isSet(flag, Flags::Diag))
+        {
+        auto const sat8 = [](std::uint32_t v) { return std::uint8_t(v > 0xFFu ? 0xFFu : v); };
+        auto const sat16 = [](std::uint32_t v) { return std::uint32_t(v > 0xFFFFu ? 0xFFFFu : v); };
+
+        gCatena.SafePrintf(
+            "SDP:  xact %u nack %u short %u long %u crc %u wake %u busy %u\n",
+            unsigned(metrics.nTransactions), unsigned(metrics.nNacks),
+            unsigned(metrics.nShortReads), unsigned(metrics.nLongReads),
+            unsigned(metrics.nCrcErrors), unsigned(metrics.nWakeRetries),
+            unsigned(metrics.nBusyPolls)
+            );
+
+        b.put2(sat16(metrics.nTransactions));
+        b.put(sat8(metrics.nNacks));
+        b.put(sat8(metrics.nShortReads));
+        b.put(sat8(metrics.nLongReads));
+        b.put(sat8(metrics.nCrcErrors));
+        b.put(sat8(metrics.nWakeRetries));
+        b.put2(sat16(metrics.nBusyPolls));
+        for (auto v : metrics.LatencyHist)
+            b.put(sat8(v));
+
+        this->m_Sdp.resetMetrics();
         }
 
-    if (this->m_fDiffPressure && this->m_measurement_valid)
+    // the quantiles: each is sent as the quantile in units of 0.5%,
+    // then the estimate as sflt16.
+    if (isSet(flag, Flags::Quantiles))
         {
-        auto const mraw = this->m_Sdp.getRawMeasurement();
-        auto const m = this->m_Sdp.getMeasurement();
+        for (auto const &q : this->m_DpQuantile)
+            {
+            const std::int32_t v = q.getEstimate();
+
+            if (gLog.isEnabled(gLog.kInfo))
+                {
+                gCatena.SafePrintf(
+                    "SDP:  P%u.%u: %d mPa\n",
+                    unsigned(q.getQuantile() / 10), unsigned(q.getQuantile() % 10),
+                    int(v)
+                    );
+                }
+
+            b.put(std::uint8_t((q.getQuantile() + 2) / 5));
+            b.put2(std::uint32_t(encodeDP(v)));
+            }
+        }
+
+    if (isSet(flag, Flags::Flow))
+        {
+        const std::int32_t volume = this->m_VolumeFlowStats.getMean();
+        const std::int32_t mass = this->m_MassFlowStats.getMean();
 
-        // temperature is 2 bytes from -163.840 to +163.835 degrees C
-        // pressure is 4 bytes, first signed units, then scale.
         if (gLog.isEnabled(gLog.kInfo))
             {
-            char ts = ' ';
-            std::int32_t t100 = std::int32_t(m.Temperature * 100.0f + 0.5f);
-            if (m.Temperature < 0) { ts = '-'; t100 = -t100; }
-            std::int32_t tint = t100 / 100;
-            std::int32_t tfrac = t100 - (tint * 100);
-
-            char dps = '+';
-            std::int32_t dp100 = std::int32_t(m.DifferentialPressure * 100.0f + 0.5f);
-            if (m.DifferentialPressure < 0) { dps = '-'; dp100 = -dp100; }
-            std::int32_t dpint = dp100 / 100;
-            std::int32_t dpfrac = dp100 - (dpint * 100);
-
-            gCatena.SafePrintf(
-                "SDP:  T: %c%d.%02d  delta-P: %c%d.%0d2\n",
-                ts, tint, tfrac,
-                dps, dpint, dpfrac
-                );
+            gCatena.SafePrintf("SDP:  flow: %ld mL/s, %ld mg/s\n", long(volume), long(mass));
             }
 
-        // put2 takes a unit32_t or int32_t; temperature is signed, so
-        // use the int32_t version.
-        b.put2(std::int32_t(mraw.TemperatureBits));
+        b.put4(volume);
+        b.put4(mass);
+        }
+
+    gLed.Set(savedLed);
+    }
+
+// the largest application payload (N in the LoRaWAN Regional Parameters)
+// at the current uplink data rate, but no more than kTxBufferSize. If the
+// region or data rate isn't known, use the smallest payload of any region.
+// N assumes an empty FOpts field; MAC responses that the LMIC will
+// piggyback on the uplink take room from the payload.
+std::size_t cMeasurementLoop::getMaxPayload()
+    {
+    static constexpr std::uint8_t kMinPayload = 11;
+
+#if defined(CFG_eu868) || defined(CFG_kr920) || defined(CFG_in866)
+    static const std::uint8_t kMaxPayload[] = { 51, 51, 51, 115, 242, 242, 242, 242 };
+#elif defined(CFG_us915)
+    static const std::uint8_t kMaxPayload[] = { 11, 53, 125, 242, 242 };
+#elif defined(CFG_au915)
+    static const std::uint8_t kMaxPayload[] = { 51, 51, 51, 115, 242, 242, 242 };
+#elif defined(CFG_as923)
+    // assume the 400 ms dwell time limit, so DR0 and DR1 can't be used.
+    static const std::uint8_t kMaxPayload[] = { kMinPayload, kMinPayload, 11, 53, 125, 242, 242, 242 };
+#else
+    static const std::uint8_t kMaxPayload[] = { kMinPayload };
+#endif
+
+    const unsigned dr = LMIC.datarate;
+    std::size_t result = kMinPayload;
+
+    if (dr < sizeof(kMaxPayload) / sizeof(kMaxPayload[0]))
+        result = kMaxPayload[dr];
 
-        // put2 takes a uint32_t or int32_t. We want the uint32_t version,
-        // so we cast. f2sflt16() takes (-1.0f, +1.0f) and returns a uint16_t
-        // as an encoding.
-        b.put2(std::uint32_t(LMIC_f2sflt16(m.DifferentialPressure * 60.0f / 32768.0f)));
+    // always leave room for the format and flag bytes.
+    const std::size_t nMac = LMIC.pendMacLen;
+    result = result > nMac + 2 ? result - nMac : 2;
 
-        flag |= Flags::DP | Flags::T;
+    return result < kTxBufferSize ? result : kTxBufferSize;
+    }
+
+// put the DP statistics for format 0x21.
+void cMeasurementLoop::putStatistics(cMeasurementLoop::TxBuffer_t& b)
+    {
+    auto const &dp = this->m_DpStats;
+    const std::int32_t dpMean = dp.getMean();
+
+    // pressure values are 2 bytes, [su]flt16 of (Pa * 60/32768).
+    if (gLog.isEnabled(gLog.kInfo))
+        {
+        const std::int32_t tMean = this->m_TStats.getMean();
+
+        char ts = ' ';
+        std::int32_t t100 = (tMean + (tMean < 0 ? -5 : 5)) / 10;
+        if (t100 < 0) { ts = '-'; t100 = -t100; }
+        std::int32_t tint = t100 / 100;
+        std::int32_t tfrac = t100 - (tint * 100);
+
+        char dps = '+';
+        std::int32_t dp100 = (dpMean + (dpMean < 0 ? -5 : 5)) / 10;
+        if (dp100 < 0) { dps = '-'; dp100 = -dp100; }
+        std::int32_t dpint = dp100 / 100;
+        std::int32_t dpfrac = dp100 - (dpint * 100);
+
+        gCatena.SafePrintf(
+            "SDP:  T: %c%d.%02d  delta-P: %c%d.%02d  (n %u, min %d, max %d, sd %u mPa)\n",
+            ts, int(tint), int(tfrac),
+            dps, int(dpint), int(dpfrac),
+            unsigned(dp.getCount()), int(dp.getMin()), int(dp.getMax()),
+            unsigned(dp.getStdDev())
+            );
         }
 
-    *pFlag = std::uint8_t(flag);
+    // the DP statistics: count, then mean, min and max as sflt16, and
+    // the standard deviation as uflt16. These are computed with
+    // integers to avoid soft-float on the STM32L0.
+    b.put(std::uint8_t(dp.getCount() > 0xFF ? 0xFF : dp.getCount()));
+    b.put2(std::uint32_t(encodeDP(dpMean)));
+    b.put2(std::uint32_t(encodeDP(dp.getMin())));
+    b.put2(std::uint32_t(encodeDP(dp.getMax())));
+    b.put2(std::uint32_t(encodeUflt16(dp.getStdDev() * 60u, 32768u * 1000u)));
+    }
 
-    gLed.Set(savedLed);
+// encode the format 0x22 DP series field into the nBuf bytes at pBuf,
+// with as many of the nValues samples at pValues as fit, oldest first;
+// the samples are interval seconds apart, and the last is newestAgeSec old.
+// Returns the number of bytes used (zero if not even one sample fits),
+// and sets nSent to the number of samples encoded.
+std::size_t cMeasurementLoop::encodeSeries(
+    const std::int32_t *pValues, std::size_t nValues,
+    std::uint32_t interval, std::uint32_t newestAgeSec,
+    std::uint8_t *pBuf, std::size_t nBuf,
+    std::size_t &nSent
+    )
+    {
+    std::size_t nTry = nValues;
+
+    nSent = 0;
+    if (nBuf < 2)
+        return 0;
+
+    // the header gives the age of the newest sample sent, which depends
+    // on how many fit; try fewer until they're consistent.
+    while (nTry != 0)
+        {
+        const std::uint32_t ageSec = newestAgeSec + std::uint32_t(nValues - nTry) * interval;
+        std::size_t nHeader = 2;
+        std::size_t nUsed;
+
+        nUsed = cDeltaSeries::putUvarint(pBuf + nHeader, nBuf - nHeader, interval);
+        if (nUsed == 0)
+            return 0;
+        nHeader += nUsed;
+
+        nUsed = cDeltaSeries::putUvarint(pBuf + nHeader, nBuf - nHeader, ageSec);
+        if (nUsed == 0)
+            return 0;
+        nHeader += nUsed;
+
+        const std::size_t n = cDeltaSeries::encode(
+                                pValues, nTry,
+                                this->getSeriesResolution(),
+                                pBuf + nHeader, nBuf - nHeader,
+                                nUsed
+                                );
+        if (n == nTry)
+            {
+            pBuf[0] = std::uint8_t(n);
+            pBuf[1] = this->m_seriesResolution;
+            nSent = n;
+
+            if (gLog.isEnabled(gLog.kInfo))
+                {
+                gCatena.SafePrintf(
+                    "SDP:  series: %u of %u samples every %lu s, newest %d mPa, %u bytes\n",
+                    unsigned(n), unsigned(nValues), (unsigned long) interval,
+                    int(pValues[n - 1]),
+                    unsigned(nHeader + nUsed)
+                    );
+                }
+
+            return nHeader + nUsed;
+            }
+
+        nTry = n;
+        }
+
+    return 0;
+    }
+
+// encode num/den (which must be in (-1, 1)) as an sflt16, using only
+// integer arithmetic. This produces the same encoding as LMIC_f2sflt16(),
+// except that values too small for a normalized result are encoded with
+// gradual underflow.
+std::uint16_t cMeasurementLoop::encodeSflt16(std::int32_t num, std::uint32_t den)
+    {
+    std::uint16_t const sign = num < 0 ? 0x8000 : 0;
+    std::uint64_t n = num < 0 ? std::uint64_t(-std::int64_t(num)) : std::uint64_t(num);
+    std::uint64_t const d = den;
+
+    if (d == 0 || n >= d)
+        return 0x7FFF | sign;
+    if (n == 0)
+        return sign;
+
+    // normalize so that n/d is in [0.5, 1), adjusting the exponent.
+    unsigned iExp = 15;
+    while (iExp > 0 && 2 * n < d)
+        {
+        n <<= 1;
+        --iExp;
+        }
+
+    // the fraction is 11 bits, rounded.
+    std::uint32_t outputFraction = std::uint32_t((n * 2048 + d / 2) / d);
+    if (outputFraction >= (1u << 11))
+        {
+        outputFraction = 1u << 10;
+        ++iExp;
+        }
+
+    if (iExp > 15)
+        return 0x7FFF | sign;
+
+    return std::uint16_t(sign | (iExp << 11u) | outputFraction);
+    }
+
+// convert num/den to uflt16, which represents [0, 1): 4 bits of exponent
+// and 12 bits of fraction. Values >= 1 saturate to 0xFFFF.
+std::uint16_t cMeasurementLoop::encodeUflt16(std::uint32_t num, std::uint32_t den)
+    {
+    std::uint64_t n = num;
+    std::uint64_t const d = den;
+
+    if (d == 0 || n >= d)
+        return 0xFFFF;
+    if (n == 0)
+        return 0;
+
+    // normalize so that n/d is in [0.5, 1), adjusting the exponent.
+    unsigned iExp = 15;
+    while (iExp > 0 && 2 * n < d)
+        {
+        n <<= 1;
+        --iExp;
+        }
+
+    // the fraction is 12 bits, rounded.
+    std::uint32_t outputFraction = std::uint32_t((n * 4096 + d / 2) / d);
+    if (outputFraction >= (1u << 12))
+        {
+        outputFraction = 1u << 11;
+        ++iExp;
+        }
+
+    if (iExp > 15)
+        return 0xFFFF;
+
+    return std::uint16_t((iExp << 12u) | outputFraction);
     }
 
 /****************************************************************************\
@@ -345,6 +723,510 @@ void cMeasurementLoop::fillTxBuffer(cMeasurementLoop::TxBuffer_t& b)
 |
 \****************************************************************************/
 
+// start the statistics for a new uplink.
+void cMeasurementLoop::resetMeasurements()
+    {
+    this->m_DpStats.clear();
+    this->m_TStats.clear();
+    this->m_VolumeFlowStats.clear();
+    this->m_MassFlowStats.clear();
+    for (unsigned i = 0; i < kNumQuantiles; ++i)
+        this->m_DpQuantile[i].setQuantile(this->m_quantilePermille[i]);
+    this->m_measurement_valid = false;
+    }
+
+// add a sample to the series waiting to be sent. Samples left from an
+// earlier uplink are moved to the backlog if they're not a regular
+// interval before this one (for example, after a failed burst), and the
+// oldest sample is moved if there's no room.
+void cMeasurementLoop::addSeriesSample(std::int32_t dp)
+    {
+    const std::uint32_t now = millis();
+    const std::uint32_t intervalMs = this->m_reportConfig.SampleSec * 1000;
+    unsigned nDropped = 0;
+
+    if (this->m_nSeries != 0 && now - this->m_seriesNewestMs > intervalMs + intervalMs / 2)
+        nDropped = this->m_nSeries;
+    else if (this->m_nSeries >= kMaxSeriesLength)
+        nDropped = 1;
+
+    if (nDropped != 0)
+        {
+        for (unsigned i = 0; i < nDropped; ++i)
+            this->addBacklog(this->getSeriesPoint(i));
+
+        this->m_nSeries = std::uint8_t(this->m_nSeries - nDropped);
+        for (unsigned i = 0; i < this->m_nSeries; ++i)
+            this->m_series[i] = this->m_series[i + nDropped];
+
+        if (gLog.isEnabled(gLog.kInfo))
+            gLog.printf(gLog.kAlways, "series: %u unsent samples moved to backlog\n", nDropped);
+        }
+
+    // the log records of the samples are found by counting back from the
+    // newest, so every sample must have been logged, in order.
+    const bool fLogged = this->m_fLastBurstLogged &&
+                         (this->m_nSeries == 0 || this->m_lastLogSeq == this->m_seriesNewestSeq + 1);
+
+    this->m_fSeriesLogged = (this->m_nSeries == 0 || this->m_fSeriesLogged) && fLogged;
+    this->m_series[this->m_nSeries++] = dp;
+    this->m_seriesNewestMs = now;
+    this->m_seriesNewestSec = this->m_lastBurstSec;
+    this->m_seriesNewestSeq = this->m_lastLogSeq;
+    }
+
+// the time and log record of sample i of the series, counting back
+// from the newest.
+cMeasurementLoop::BacklogPoint cMeasurementLoop::getSeriesPoint(unsigned i) const
+    {
+    const std::uint32_t nBack = this->m_nSeries - 1 - i;
+
+    return  {
+            this->m_seriesNewestSeq - nBack,
+            this->m_seriesNewestSec - nBack * this->m_reportConfig.SampleSec,
+            this->m_series[i],
+            this->m_fSeriesLogged
+            };
+    }
+
+// start a burst of measurements. The filter is restarted, because the
+// previous burst was a cycle ago.
+void cMeasurementLoop::startBurst()
+    {
+    this->m_DpFilter.reset();
+    this->m_BurstDpStats.clear();
+    this->m_BurstTStats.clear();
+    this->m_nRequested = 0;
+    }
+
+// seconds since boot. millis() wraps after 49 days, so whole seconds
+// are moved from it to m_uptimeSec as they pass.
+std::uint32_t cMeasurementLoop::getUptime()
+    {
+    const std::uint32_t nSec = (millis() - this->m_uptimeMs) / 1000;
+
+    this->m_uptimeSec += nSec;
+    this->m_uptimeMs += nSec * 1000;
+    return this->m_uptimeSec;
+    }
+
+// record the summary of the burst just finished in the flash log, if any.
+void cMeasurementLoop::logBurst()
+    {
+    this->m_fLastBurstLogged = false;
+    if (this->m_pFlashLog == nullptr || this->m_BurstDpStats.getCount() == 0)
+        return;
+
+    cFlashLog::Record r;
+    std::uint32_t bootCount;
+
+    r.BootCount = gCatena.getBootCount(bootCount) ? bootCount : 0;
+    r.Seconds = this->m_lastBurstSec;
+    r.DpMeanMilliPa = this->m_BurstDpStats.getMean();
+    r.DpMinMilliPa = this->m_BurstDpStats.getMin();
+    r.DpMaxMilliPa = this->m_BurstDpStats.getMax();
+    r.TMeanMilliC = this->m_BurstTStats.getMean();
+    r.nSamples = std::uint8_t(this->m_BurstDpStats.getCount());
+
+    if (! this->m_pFlashLog->append(r))
+        {
+        if (gLog.isEnabled(gLog.kError))
+            gLog.printf(gLog.kAlways, "flash log: append failed\n");
+        }
+    else
+        {
+        this->m_lastLogSeq = r.Sequence;
+        this->m_fLastBurstLogged = true;
+        if (gLog.isEnabled(gLog.kTrace))
+            gLog.printf(gLog.kAlways, "flash log: record %lu\n", (unsigned long) r.Sequence);
+        }
+    }
+
+bool cMeasurementLoop::setReportConfig(const ReportConfig &config)
+    {
+    if (config.SampleSec == 0)
+        return false;
+
+    this->m_reportConfig = config;
+    this->m_nSilentCycles = 0;
+    this->m_fReported = false;
+    this->setCycleTime(this->getCycleTime());
+    return true;
+    }
+
+bool cMeasurementLoop::setMessageFormat(
+    std::uint8_t format,
+    unsigned seriesLength,
+    std::uint32_t resolutionMilliPa
+    )
+    {
+    if (! (format == kMessageFormat || format == kSeriesMessageFormat))
+        return false;
+    if (seriesLength == 0 || seriesLength > kMaxSeriesLength)
+        return false;
+    if (resolutionMilliPa == 0 || resolutionMilliPa % kSeriesResolutionUnit != 0 ||
+        resolutionMilliPa / kSeriesResolutionUnit > 0xFF)
+        return false;
+
+    if (format != this->m_messageFormat)
+        this->m_nSeries = 0;
+
+    this->m_messageFormat = format;
+    this->m_seriesLength = std::uint8_t(seriesLength);
+    this->m_seriesResolution = std::uint8_t(resolutionMilliPa / kSeriesResolutionUnit);
+    this->setCycleTime(this->getCycleTime());
+    return true;
+    }
+
+// decide whether to uplink after a burst; always true unless reporting
+// on change or sending series. A series is sent when it's full, or when
+// a burst fails, because the timestamps assume the samples are regular.
+bool cMeasurementLoop::checkReport()
+    {
+    auto const &config = this->m_reportConfig;
+    const bool fSeries = this->m_messageFormat == kSeriesMessageFormat;
+    bool fReport;
+
+    ++this->m_nSilentCycles;
+    if (fSeries && this->m_BurstDpStats.getCount() != 0)
+        this->addSeriesSample(this->m_BurstDpStats.getMean());
+
+    if (fSeries && this->m_nSeries >= this->m_seriesLength)
+        fReport = true;
+    else if (fSeries && this->m_BurstDpStats.getCount() == 0 && this->m_nSeries != 0)
+        fReport = true;
+    else if (! config.fOnChange)
+        fReport = ! fSeries;
+    else if (std::uint64_t(this->m_nSilentCycles) * config.SampleSec >= config.HeartbeatSec)
+        fReport = true;
+    else if (this->m_BurstDpStats.getCount() == 0)
+        fReport = false;
+    else if (! this->m_fReported)
+        fReport = true;
+    else
+        {
+        const std::int64_t last = this->m_lastReportedDp;
+        const std::int64_t delta = std::int64_t(this->m_BurstDpStats.getMean()) - last;
+        const std::int64_t relative = (last < 0 ? -last : last) * config.DeadbandPermille / 1000;
+        const std::int64_t deadband = relative > config.DeadbandMilliPa ? relative : config.DeadbandMilliPa;
+
+        fReport = delta > deadband || -delta > deadband;
+        }
+
+    if (! fReport)
+        {
+        if (gLog.isEnabled(gLog.kTrace))
+            gLog.printf(gLog.kAlways, "no uplink; %u measurements since last uplink\n",
+                unsigned(this->m_nSilentCycles)
+                );
+        return false;
+        }
+
+    if (this->m_BurstDpStats.getCount() != 0)
+        {
+        this->m_lastReportedDp = this->m_BurstDpStats.getMean();
+        this->m_fReported = true;
+        }
+    this->m_nSilentCycles = 0;
+    return true;
+    }
+
+bool cMeasurementLoop::setQuantile(unsigned i, std::uint16_t permille)
+    {
+    if (i >= kNumQuantiles || permille > 1000)
+        return false;
+
+    this->m_quantilePermille[i] = permille;
+    return true;
+    }
+
+// queue the next measurement of the burst; the last one puts the
+// sensor to sleep.
+bool cMeasurementLoop::requestMeasurement()
+    {
+    const bool fLast = this->m_nRequested + 1u >= kNumMeasurements;
+
+    if (! this->m_SdpAsync.requestMeasurement(measurementDoneCb, (void *) this, fLast))
+        return false;
+
+    ++this->m_nRequested;
+    return true;
+    }
+
+// DP readings go through the filter; only its outputs are counted, so
+// with decimation there may be fewer DP values than measurements.
+void cMeasurementLoop::addMeasurement(const cSDP::MeasurementFixed &m)
+    {
+    std::int32_t dp;
+
+    this->m_TStats.add(m.TemperatureMilliC);
+    this->m_BurstTStats.add(m.TemperatureMilliC);
+    if (! this->m_DpFilter.put(m.DifferentialPressureMilliPa, dp))
+        return;
+
+    this->m_DpStats.add(dp);
+    this->m_BurstDpStats.add(dp);
+    for (auto &q : this->m_DpQuantile)
+        q.add(dp);
+
+    // flow is not linear in DP, so it's averaged per reading.
+    cSDPFlow::Flow flow;
+    if (this->m_Flow.compute(dp, m.TemperatureMilliC, flow))
+        {
+        this->m_VolumeFlowStats.add(flow.VolumeMilliLPerS);
+        this->m_MassFlowStats.add(flow.MassMgPerS);
+        }
+    this->m_measurement_valid = true;
+    }
+
+// called from m_SdpAsync.poll() when a measurement finishes. Accumulate
+// the result, and start the next measurement of the burst.
+void cMeasurementLoop::measurementDoneCb(void *pClientData, cSDP &sdp, bool fSuccess)
+    {
+    auto const pThis = (cMeasurementLoop *)pClientData;
+
+    if (fSuccess)
+        {
+        // the engine finishes begin() if it was waiting for wakeup, so a
+        // good measurement also means the sensor is present.
+        pThis->m_fDiffPressure = true;
+        pThis->addMeasurement(sdp.getMeasurementFixed());
+
+        if (pThis->m_nRequested < kNumMeasurements && pThis->requestMeasurement())
+            return;
+        }
+    else if (gLog.isEnabled(gLog.kError))
+        {
+        gLog.printf(gLog.kAlways, "SDP measurement failed: error %s(%u)\n",
+                sdp.getLastErrorName(),
+                unsigned(sdp.getLastError())
+            );
+        }
+
+    pThis->m_fMeasurementDone = true;
+    }
+
+/****************************************************************************\
+|
+|   Backfill: resend data from failed uplinks
+|
+\****************************************************************************/
+
+// add a point to the backlog. If the backlog is full, the oldest point is
+// left in the flash log, if its value is that of its log record, so that
+// backfill sends the same value the uplink would have. Otherwise, the
+// oldest point is dropped.
+void cMeasurementLoop::addBacklog(const BacklogPoint &p)
+    {
+    if (this->m_nBacklog >= kBacklogLength)
+        {
+        const BacklogPoint &oldest = this->m_backlog[this->m_backlogHead];
+
+        if (this->m_pFlashLog != nullptr && oldest.fLogged)
+            this->addFlashBacklog(oldest.Sequence);
+        else if (gLog.isEnabled(gLog.kInfo))
+            gLog.printf(gLog.kAlways, "backlog full: oldest point dropped\n");
+
+        this->m_backlogHead = std::uint8_t((this->m_backlogHead + 1) % kBacklogLength);
+        --this->m_nBacklog;
+        }
+
+    this->m_backlog[(this->m_backlogHead + this->m_nBacklog) % kBacklogLength] = p;
+    ++this->m_nBacklog;
+    }
+
+// add a log record to those to be sent. Records arrive in order; one
+// that doesn't follow the newest run starts a new run, so the records in
+// between, which were sent, aren't sent again. If there are too many
+// runs, the oldest is dropped.
+void cMeasurementLoop::addFlashBacklog(std::uint32_t sequence)
+    {
+    if (this->m_nFlashRanges != 0)
+        {
+        FlashRange &newest = this->m_flashRanges[(this->m_flashRangeHead + this->m_nFlashRanges - 1) % kMaxFlashRanges];
+
+        if (sequence == newest.End)
+            {
+            ++newest.End;
+            return;
+            }
+        if (std::int32_t(sequence - newest.End) < 0)
+            return;
+        }
+
+    if (this->m_nFlashRanges >= kMaxFlashRanges)
+        {
+        if (gLog.isEnabled(gLog.kInfo))
+            gLog.printf(gLog.kAlways, "backlog full: oldest log records dropped\n");
+
+        this->m_flashRangeHead = std::uint8_t((this->m_flashRangeHead + 1) % kMaxFlashRanges);
+        --this->m_nFlashRanges;
+        }
+
+    this->m_flashRanges[(this->m_flashRangeHead + this->m_nFlashRanges) % kMaxFlashRanges] = { sequence, sequence + 1 };
+    ++this->m_nFlashRanges;
+    }
+
+bool cMeasurementLoop::startBackfill()
+    {
+    TxBuffer_t b;
+
+    if (! this->fillBackfillBuffer(b))
+        return false;
+
+    this->startTransmission(b);
+    return true;
+    }
+
+// prepare a format 0x22 uplink with the oldest points in the backlog that
+// are evenly spaced: from the flash log first, as those are older, then
+// from RAM. Returns false if there's nothing to send. The points are
+// removed from the backlog by commitBackfill(), once the uplink succeeds.
+bool cMeasurementLoop::fillBackfillBuffer(cMeasurementLoop::TxBuffer_t &b)
+    {
+    BacklogPoint run[kMaxSeriesLength];
+    unsigned nRun = 0;
+
+    // p continues the run if it's the same interval after the last point
+    // as the run started with, give or take a second or 5%.
+    auto const fitsRun =
+        [&run, &nRun](const BacklogPoint &p) -> bool
+            {
+            if (nRun == 0)
+                return true;
+
+            const std::int32_t last = std::int32_t(p.Seconds - run[nRun - 1].Seconds);
+
+            if (last <= 0)
+                return false;
+            if (nRun == 1)
+                return true;
+
+            const std::int32_t interval = std::int32_t(run[1].Seconds - run[0].Seconds);
+            const std::int32_t error = std::int32_t(p.Seconds - run[0].Seconds) - std::int32_t(nRun) * interval;
+
+            return (error < 0 ? -error : error) <= 1 + interval / 20;
+            };
+
+    this->m_fBackfillFromFlash = false;
+    while (this->m_pFlashLog != nullptr && this->m_nFlashRanges != 0 && nRun == 0)
+        {
+        // skip records that have been overwritten, or can't be read.
+        cFlashLog &log = *this->m_pFlashLog;
+        FlashRange &range = this->m_flashRanges[this->m_flashRangeHead];
+        std::uint32_t bootCount;
+        std::uint32_t seq = range.First;
+
+        if (! gCatena.getBootCount(bootCount))
+            bootCount = 0;
+        if (std::int32_t(seq - log.getFirstSequence()) < 0)
+            seq = log.getFirstSequence();
+        if (std::int32_t(range.End - log.getNextSequence()) > 0)
+            range.End = log.getNextSequence();
+
+        for (; std::int32_t(range.End - seq) > 0 && nRun < kMaxSeriesLength; ++seq)
+            {
+            cFlashLog::Record r;
+
+            if (! log.read(seq, r) || r.BootCount != bootCount)
+                {
+                if (nRun == 0)
+                    continue;
+                break;
+                }
+
+            const BacklogPoint p { seq, r.Seconds, r.DpMeanMilliPa, true };
+
+            if (! fitsRun(p))
+                break;
+            run[nRun++] = p;
+            }
+
+        // nothing left in this run: go on to the next.
+        if (nRun == 0)
+            {
+            this->m_flashRangeHead = std::uint8_t((this->m_flashRangeHead + 1) % kMaxFlashRanges);
+            --this->m_nFlashRanges;
+            }
+        else
+            {
+            range.First = run[0].Sequence;
+            this->m_fBackfillFromFlash = true;
+            }
+        }
+
+    if (nRun == 0)
+        {
+        for (unsigned i = 0; i < this->m_nBacklog && nRun < kMaxSeriesLength; ++i)
+            {
+            const BacklogPoint &p = this->m_backlog[(this->m_backlogHead + i) % kBacklogLength];
+
+            if (! fitsRun(p))
+                break;
+            run[nRun++] = p;
+            }
+        }
+
+    if (nRun == 0)
+        return false;
+
+    std::int32_t values[kMaxSeriesLength];
+    std::uint8_t series[kTxBufferSize];
+    std::size_t nSent;
+
+    for (unsigned i = 0; i < nRun; ++i)
+        values[i] = run[i].DpMilliPa;
+
+    const std::uint32_t interval = nRun < 2 ? 0
+                                 : (run[nRun - 1].Seconds - run[0].Seconds + (nRun - 1) / 2) / (nRun - 1);
+    const std::size_t nSeriesBytes = this->encodeSeries(
+                                        values, nRun,
+                                        interval,
+                                        this->getUptime() - run[nRun - 1].Seconds,
+                                        series, getMaxPayload() - 2, nSent
+                                        );
+    if (nSeriesBytes == 0)
+        return false;
+
+    this->m_nBackfillPoints = std::uint8_t(nSent);
+    this->m_backfillFlashNext = run[nSent - 1].Sequence + 1;
+
+    if (gLog.isEnabled(gLog.kInfo))
+        gCatena.SafePrintf("backfill: %u points from %s, %u in RAM\n",
+            unsigned(nSent), this->m_fBackfillFromFlash ? "flash" : "RAM",
+            unsigned(this->m_nBacklog)
+            );
+
+    b.begin();
+    b.put(kSeriesMessageFormat);
+    b.put(std::uint8_t(Flags::Series));
+    for (std::size_t i = 0; i < nSeriesBytes; ++i)
+        b.put(series[i]);
+
+    return true;
+    }
+
+// the backfill uplink was sent; drop its points from the backlog.
+void cMeasurementLoop::commitBackfill()
+    {
+    if (this->m_fBackfillFromFlash)
+        {
+        FlashRange &range = this->m_flashRanges[this->m_flashRangeHead];
+
+        range.First = this->m_backfillFlashNext;
+        if (std::int32_t(range.End - range.First) <= 0)
+            {
+            this->m_flashRangeHead = std::uint8_t((this->m_flashRangeHead + 1) % kMaxFlashRanges);
+            --this->m_nFlashRanges;
+            }
+        }
+    else
+        {
+        this->m_backlogHead = std::uint8_t((this->m_backlogHead + this->m_nBackfillPoints) % kBacklogLength);
+        this->m_nBacklog = std::uint8_t(this->m_nBacklog - this->m_nBackfillPoints);
+        }
+    }
+
 /****************************************************************************\
 |
 |   Start uplink of data
@@ -429,6 +1311,15 @@ void cMeasurementLoop::poll()
             }
         }
 
+    // while measuring, let the engine make progress; it only talks to
+    // the sensor when the data should be ready.
+    if (this->m_fMeasuring)
+        {
+        this->m_SdpAsync.poll();
+        if (this->m_fMeasurementDone)
+            fEvent = true;
+        }
+
     // check the transmit time.
     if (this->m_UplinkTimer.peekTicks() != 0)
         {
@@ -627,10 +1518,11 @@ void cMeasurementLoop::deepSleepRecovery(void)
     // start the SDP, and make sure it passes the bring-up.
     // record success in m_fDiffPressure, which is used later
     // when collecting results to transmit.
+    // the SDP may not answer at once; if so, m_SdpAsync finishes the job.
     this->m_fDiffPressure = this->m_Sdp.begin();
 
     // if it didn't start, log a message.
-    if (! this->m_fDiffPressure)
+    if (! this->m_fDiffPressure && this->m_Sdp.getLastError() != cSDP::Error::WakeupPending)
         {
         if (gLog.isEnabled(gLog.DebugFlags::kError))
             gLog.printf(
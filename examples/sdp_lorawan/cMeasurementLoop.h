@@ -35,11 +35,18 @@ Author:
 #include <Catena_Timer.h>
 #include <Catena_TxBuffer.h>
 #include <MCCI_Catena_SDP.h>
+#include <MCCI_Catena_SDP_Async.h>
+#include <MCCI_Catena_SDP_Filter.h>
+#include <MCCI_Catena_SDP_Flow.h>
+#include <MCCI_Catena_SDP_Series.h>
+#include <MCCI_Catena_SDP_Stats.h>
 #include <mcciadk_baselib.h>
 #include <stdlib.h>
 
 #include <cstdint>
 
+#include "cFlashLog.h"
+
 /****************************************************************************\
 |
 |   An object to represent the uplink activity
@@ -54,10 +61,14 @@ public:
             McciCatenaSdp::cSDP& sdp3x
             )
         : m_Sdp(sdp3x)
+        , m_SdpAsync(sdp3x)
         , m_txCycleSec_Permanent(6 * 60)    // default uplink interval
         , m_txCycleSec(30)                  // initial uplink interval
         , m_txCycleCount(10)                // initial count of fast uplinks
-        {};
+        {
+        // reject single-reading spikes by default.
+        this->m_DpFilter.configure({ 3, 0, 1 });
+        };
 
     // neither copyable nor movable
     cMeasurementLoop(const cMeasurementLoop&) = delete;
@@ -75,6 +86,7 @@ public:
         stMeasure,   	// make the measurements
         stSleepSensor,  // sleep
         stTransmit,     // transmit data
+        stBackfill,     // transmit data from earlier failed uplinks
 
         stFinal,        // this name must be present, it's the terminal state.
         };
@@ -91,26 +103,64 @@ public:
         case State::stMeasure: return "stMeasure";
         case State::stSleepSensor: return "stSleepSensor";
         case State::stTransmit: return "stTransmit";
+        case State::stBackfill: return "stBackfill";
         case State::stFinal: return "stFinal";
         default: return "<<unknown>>";
             }
         }
 
     static constexpr uint8_t kUplinkPort = 1;
-    static constexpr uint8_t kMessageFormat = 0x1F;
+    static constexpr uint8_t kMessageFormat = 0x21;
+    static constexpr uint8_t kSeriesMessageFormat = 0x22;
 
     enum class Flags : uint8_t
             {
             Vbat = 1 << 0,
             Vcc = 1 << 1,
             Boot = 1 << 2,
-            T = 1 << 3,     // temperature (int16, 0.005 deg C)
-            DP = 1 << 4,    // Differential pressure (sflt, Pa * 60/32768)
+            T = 1 << 3,     // mean temperature (int16, 0.005 deg C)
+            DP = 1 << 4,    // DP statistics (n, mean, min, max, std dev)
+            Diag = 1 << 5,  // driver diagnostics (counts since last uplink)
+            Quantiles = 1 << 6, // DP quantiles (kNumQuantiles x (q, value))
+            Flow = 1 << 7,  // mean flow (int32 mL/s, int32 mg/s)
+            // in format 0x22, DP is a series of samples instead.
+            Series = DP,
             };
 
-    static constexpr size_t kTxBufferSize = 36;
+    // the largest uplink we'll send. At low data rates, fewer bytes are
+    // sent; see getMaxPayload().
+    static constexpr size_t kTxBufferSize = 64;
+
+    // number of DP quantiles estimated each uplink interval.
+    static constexpr unsigned kNumQuantiles = 2;
+
+    // most samples in one format 0x22 uplink, and most samples waiting
+    // to be sent.
+    static constexpr unsigned kMaxSeriesLength = 20;
+
+    // most points from failed uplinks kept in RAM; see setBackfillLimit().
+    static constexpr unsigned kBacklogLength = 24;
+    // most separate runs of flash log records waiting to be sent.
+    static constexpr unsigned kMaxFlashRanges = 4;
     using TxBuffer_t = McciCatena::AbstractTxBuffer_t<kTxBufferSize>;
 
+    // reporting policy. Normally, the loop measures and uplinks every tx
+    // cycle. If fOnChange, or if sending series (format 0x22), it measures
+    // every SampleSec instead. If fOnChange, it uplinks only
+    // if the mean DP of the latest measurements differs from the last
+    // uplinked value by more than the larger of DeadbandMilliPa and
+    // DeadbandPermille of that value, or if nothing has been sent for
+    // HeartbeatSec. The statistics in each uplink cover all measurements
+    // since the previous uplink.
+    struct ReportConfig
+        {
+        bool fOnChange;                 /// report by exception
+        std::uint32_t SampleSec;        /// measurement interval if fOnChange or series
+        std::uint32_t DeadbandMilliPa;  /// absolute deadband
+        std::uint16_t DeadbandPermille; /// relative deadband
+        std::uint32_t HeartbeatSec;     /// longest interval without an uplink
+        };
+
     // initialize measurement FSM.
     void begin();
     void end();
@@ -122,9 +172,7 @@ public:
         this->m_txCycleSec = txCycleSec;
         this->m_txCycleCount = txCycleCount;
 
-        this->m_UplinkTimer.setInterval(txCycleSec * 1000);
-        if (this->m_UplinkTimer.peekTicks() != 0)
-            this->m_fsm.eval();
+        this->setCycleTime(this->getCycleTime());
         }
     std::uint32_t getTxCycleTime()
         {
@@ -134,13 +182,171 @@ public:
 
     // request that the measurement loop be active/inactive
     void requestActive(bool fEnable);
+    // true if the loop is parked (after requestActive(false)), and not
+    // using the sensor.
+    bool isInactive() const
+        {
+        return this->m_fsm.getState() == State::stInactive;
+        }
+
+    // set or get the DP quantiles to be reported, in permille (for
+    // example, 500 for the median). setQuantile() fails if i is out of
+    // range or permille is over 1000; the change applies from the next
+    // measurement burst.
+    bool setQuantile(unsigned i, std::uint16_t permille);
+    std::uint16_t getQuantile(unsigned i) const
+        {
+        return i < kNumQuantiles ? this->m_quantilePermille[i] : 0;
+        }
+
+    // set or get the configuration of the DP filter chain; see
+    // cSDPFilter. The change applies from the next measurement burst.
+    bool setFilterConfig(const McciCatenaSdp::cSDPFilter::Config &config)
+        {
+        return this->m_DpFilter.configure(config);
+        }
+    const McciCatenaSdp::cSDPFilter::Config &getFilterConfig() const
+        {
+        return this->m_DpFilter.getConfig();
+        }
+
+    // set or get the flow element; flow is reported only if an element is
+    // configured. The change applies from the next measurement burst.
+    bool setFlowConfig(const McciCatenaSdp::cSDPFlow::Config &config)
+        {
+        return this->m_Flow.configure(config);
+        }
+    const McciCatenaSdp::cSDPFlow::Config &getFlowConfig() const
+        {
+        return this->m_Flow.getConfig();
+        }
+
+    // set or get the reporting policy. setReportConfig() fails if
+    // SampleSec is zero.
+    bool setReportConfig(const ReportConfig &config);
+    const ReportConfig &getReportConfig() const
+        {
+        return this->m_reportConfig;
+        }
+
+    // set or get the uplink format: kMessageFormat sends statistics for
+    // each uplink, kSeriesMessageFormat sends the mean DP of each burst,
+    // seriesLength at a time, with resolutionMilliPa (a multiple of 10,
+    // up to 2550). setMessageFormat() fails if any parameter is out of
+    // range; the change applies from the next uplink.
+    bool setMessageFormat(
+        std::uint8_t format,
+        unsigned seriesLength = 12,
+        std::uint32_t resolutionMilliPa = 10
+        );
+    std::uint8_t getMessageFormat() const
+        {
+        return this->m_messageFormat;
+        }
+    unsigned getSeriesLength() const
+        {
+        return this->m_seriesLength;
+        }
+    std::uint32_t getSeriesResolution() const
+        {
+        return this->m_seriesResolution * kSeriesResolutionUnit;
+        }
+
+    // set or get the log that records a summary of each burst; nullptr
+    // (the default) disables logging. The log must be ready.
+    void setFlashLog(cFlashLog *pLog)
+        {
+        this->m_pFlashLog = pLog;
+        }
+    cFlashLog *getFlashLog() const
+        {
+        return this->m_pFlashLog;
+        }
+
+    // set or get the most backfill uplinks sent after each successful
+    // uplink; 0 disables backfill. The DP from uplinks that fail (or
+    // samples that can't be sent) is kept in a backlog of up to
+    // kBacklogLength points. When that's full, the oldest point is left
+    // in the flash log if it's a burst mean (as in format 0x22) that was
+    // logged; otherwise (as for the window means of format 0x21) it's
+    // dropped. Backfill uplinks use format 0x22, with the ages of the
+    // points.
+    void setBackfillLimit(std::uint8_t nUplinks)
+        {
+        this->m_backfillLimit = nUplinks;
+        }
+    std::uint8_t getBackfillLimit() const
+        {
+        return this->m_backfillLimit;
+        }
+    // the number of points waiting in RAM, and in the flash log.
+    unsigned getBacklogCount() const
+        {
+        return this->m_nBacklog;
+        }
+    std::uint32_t getBacklogFlashCount() const
+        {
+        std::uint32_t n = 0;
+
+        for (unsigned i = 0; i < this->m_nFlashRanges; ++i)
+            {
+            auto const &r = this->m_flashRanges[(this->m_flashRangeHead + i) % kMaxFlashRanges];
+            n += r.End - r.First;
+            }
+        return n;
+        }
 
 private:
+    // number of measurements in each burst; they're reduced to summary
+    // statistics for the uplink.
     static constexpr unsigned kNumMeasurements = 10;
 
+    // size of the driver diagnostics field, as put by fillTxBuffer(): the
+    // transaction count (uint16), five uint8 counters, the busy-poll
+    // count (uint16), and one uint8 per latency histogram bin.
+    static constexpr std::size_t kDiagBytes =
+        2 + 5 * 1 + 2 + McciCatenaSdp::cSDP::Metrics::kLatencyBins * 1;
+
+    // units of the format 0x22 resolution byte, in mPa.
+    static constexpr std::uint32_t kSeriesResolutionUnit = 10;
+
+    // a DP value waiting to be sent, with the time it was measured and
+    // the sequence number of the log record of the burst.
+    struct BacklogPoint
+        {
+        std::uint32_t Sequence;         /// flash log record
+        std::uint32_t Seconds;          /// uptime when measured
+        std::int32_t DpMilliPa;         /// the value
+        bool fLogged;                   /// true if the value is the DP mean of record Sequence
+        };
+
+    // a run of flash log records waiting to be sent, [First, End).
+    struct FlashRange
+        {
+        std::uint32_t First;            /// first record
+        std::uint32_t End;              /// record after the last
+        };
+
     // evaluate the control FSM.
     State fsmDispatch(State currentState, bool fEntry);
 
+    // the interval between measurements, in seconds.
+    std::uint32_t getCycleTime() const
+        {
+        return (this->m_reportConfig.fOnChange ||
+                this->m_messageFormat == kSeriesMessageFormat)
+                    ? this->m_reportConfig.SampleSec
+                    : this->m_txCycleSec;
+        }
+
+    // set the interval of m_UplinkTimer, which starts each measurement.
+    void setCycleTime(std::uint32_t cycleSec)
+        {
+        this->m_UplinkTimer.setInterval(cycleSec * 1000);
+        if (this->m_UplinkTimer.peekTicks() != 0)
+            this->m_fsm.eval();
+        }
+
     // set the timer
     void setTimer(std::uint32_t ms)
         {
@@ -169,7 +375,41 @@ private:
     void deepSleepPrepare();
     void deepSleepRecovery();
 
+    static void measurementDoneCb(void *pClientData, McciCatenaSdp::cSDP &sdp, bool fSuccess);
+    bool requestMeasurement();
+    void resetMeasurements();
+    void startBurst();
+    bool checkReport();
+    void addSeriesSample(std::int32_t dp);
+    BacklogPoint getSeriesPoint(unsigned i) const;
+    void logBurst();
+    std::uint32_t getUptime();
+    void addBacklog(const BacklogPoint &p);
+    void addFlashBacklog(std::uint32_t sequence);
+    bool hasBacklog() const
+        {
+        return this->m_nBacklog != 0 || this->m_nFlashRanges != 0;
+        }
+    bool startBackfill();
+    bool fillBackfillBuffer(TxBuffer_t &b);
+    void commitBackfill();
+    void addMeasurement(const McciCatenaSdp::cSDP::MeasurementFixed &m);
     void fillTxBuffer(TxBuffer_t &b);
+    static std::size_t getMaxPayload();
+    void putStatistics(TxBuffer_t &b);
+    std::size_t encodeSeries(
+        const std::int32_t *pValues, std::size_t nValues,
+        std::uint32_t interval, std::uint32_t newestAgeSec,
+        std::uint8_t *pBuf, std::size_t nBuf,
+        std::size_t &nSent
+        );
+    static std::uint16_t encodeSflt16(std::int32_t num, std::uint32_t den);
+    static std::uint16_t encodeUflt16(std::uint32_t num, std::uint32_t den);
+    static std::uint16_t encodeDP(std::int32_t milliPa)
+        {
+        // sflt16 of Pa * 60 / 32768
+        return encodeSflt16(milliPa * 60, 32768u * 1000u);
+        }
     void startTransmission(TxBuffer_t &b);
     void sendBufferDone(bool fSuccess);
     bool txComplete()
@@ -182,6 +422,67 @@ private:
     McciCatena::cFSM <cMeasurementLoop, State>
                         m_fsm;
     McciCatenaSdp::cSDP&    m_Sdp;
+    McciCatenaSdp::cSDPAsync    m_SdpAsync;
+
+    // filter for DP readings, ahead of the statistics
+    McciCatenaSdp::cSDPFilter       m_DpFilter;
+    // statistics for the current burst
+    McciCatenaSdp::cRunningStats    m_DpStats;
+    McciCatenaSdp::cRunningStats    m_TStats;
+    McciCatenaSdp::cP2Quantile      m_DpQuantile[kNumQuantiles];
+    // flow, computed from each filtered DP reading
+    McciCatenaSdp::cSDPFlow         m_Flow;
+    McciCatenaSdp::cRunningStats    m_VolumeFlowStats;
+    McciCatenaSdp::cRunningStats    m_MassFlowStats;
+    // quantiles to be reported, in permille
+    std::uint16_t       m_quantilePermille[kNumQuantiles] { 500, 950 };
+    // number of measurements requested in the current burst
+    std::uint8_t        m_nRequested;
+    // DP and temperature statistics for the current burst only
+    McciCatenaSdp::cRunningStats    m_BurstDpStats;
+    McciCatenaSdp::cRunningStats    m_BurstTStats;
+
+    // the log of burst summaries, if any, and the last record written
+    cFlashLog           *m_pFlashLog { nullptr };
+    std::uint32_t       m_lastLogSeq { 0 };
+    // uptime at the end of the last burst
+    std::uint32_t       m_lastBurstSec { 0 };
+    // seconds since boot, and the millis() they count up to
+    std::uint32_t       m_uptimeSec { 0 };
+    std::uint32_t       m_uptimeMs { 0 };
+
+    // reporting policy, and state for report-by-exception
+    ReportConfig        m_reportConfig { false, 60, 500, 50, 60 * 60 };
+    std::int32_t        m_lastReportedDp;   // mean DP at last uplink
+    std::uint32_t       m_nSilentCycles;    // measurements since last uplink
+
+    // uplink format, and the series of burst means for format 0x22
+    std::uint8_t        m_messageFormat { kMessageFormat };
+    std::uint8_t        m_seriesLength { 12 };
+    std::uint8_t        m_seriesResolution { 1 };   // kSeriesResolutionUnit mPa
+    std::uint8_t        m_nSeries;
+    std::int32_t        m_series[kMaxSeriesLength];
+    std::uint32_t       m_seriesNewestMs;   // millis() of m_series[m_nSeries - 1]
+    std::uint32_t       m_seriesNewestSec;  // its uptime
+    std::uint32_t       m_seriesNewestSeq;  // its log record
+
+    // the points in the uplink being sent, kept for backfill if it fails
+    BacklogPoint        m_inFlight[kMaxSeriesLength];
+    std::uint8_t        m_nInFlight;
+
+    // the backlog for backfill: a ring of points in RAM, after a ring of
+    // runs of log records, oldest first. Records between runs were sent.
+    BacklogPoint        m_backlog[kBacklogLength];
+    std::uint8_t        m_backlogHead { 0 };
+    std::uint8_t        m_nBacklog { 0 };
+    FlashRange          m_flashRanges[kMaxFlashRanges];
+    std::uint8_t        m_flashRangeHead { 0 };
+    std::uint8_t        m_nFlashRanges { 0 };
+    // backfill rate limit, and the state of the backfill uplink being sent
+    std::uint8_t        m_backfillLimit { 2 };
+    std::uint8_t        m_nBackfillSent;
+    std::uint8_t        m_nBackfillPoints;  // points in the uplink, from RAM
+    std::uint32_t       m_backfillFlashNext; // log record after the uplink
 
     // true if object is registered for polling.
     bool                m_registered : 1;
@@ -214,6 +515,20 @@ private:
     bool                m_txerr : 1;
     // set true when we've printed how we plan to sleep
     bool                m_fPrintedSleeping : 1;
+    // set true while waiting for the SDP to finish a measurement.
+    bool                m_fMeasuring : 1;
+    // set true when m_SdpAsync reports the measurement is done.
+    bool                m_fMeasurementDone : 1;
+    // set true while statistics are accumulating for the next uplink.
+    bool                m_fWindowOpen : 1;
+    // set true once m_lastReportedDp is valid.
+    bool                m_fReported : 1;
+    // set true if the backfill uplink being sent is from the flash log.
+    bool                m_fBackfillFromFlash : 1;
+    // set true if the last burst was written to the flash log.
+    bool                m_fLastBurstLogged : 1;
+    // set true if every sample of the series has a log record, in order.
+    bool                m_fSeriesLogged : 1;
 
     // uplink time control
     McciCatena::cTimer  m_UplinkTimer;
@@ -237,6 +552,11 @@ static cMeasurementLoop::Flags operator|= (cMeasurementLoop::Flags &lhs, const c
         return lhs;
         };
 
+static constexpr bool isSet(const cMeasurementLoop::Flags flags, const cMeasurementLoop::Flags f)
+        {
+        return (uint8_t(flags) & uint8_t(f)) != 0;
+        };
+
 
 
 #endif /* _cMeasurementLoop_h_ */
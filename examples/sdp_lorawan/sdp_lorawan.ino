@@ -21,6 +21,8 @@ Author:
 #include "sdp_lorawan.h"
 #include "cMeasurementLoop.h"
 #include <arduino_lmic.h>
+#include <MCCI_Catena_SDP_Calibration.h>
+#include <MCCI_Catena_SDP_Product.h>
 
 using namespace McciCatena;
 using namespace McciCatenaSdp;
@@ -40,6 +42,12 @@ static constexpr bool k4801 = true;
 static constexpr bool k4801 = false;
 #endif
 
+// the calibration table is saved in the top 256 bytes of the 8 KiB FRAM,
+// clear of the platform's storage objects, which are packed from the
+// bottom.
+static constexpr std::uint32_t kCalibrationFramOffset = 0x2000 - 0x100;
+static_assert(cSDPCalibration::kMaxSerializedSize <= 0x100, "calibration table too big for its FRAM area");
+
 /****************************************************************************\
 |
 |   Variables.
@@ -67,9 +75,15 @@ SPIClass gSPI2(
 Catena_Mx25v8035f gFlash;
 // status flag, true if flash was probed at boot.
 bool gfFlash;
+// the measurement log, in the upper half of the flash
+cFlashLog gFlashLog { gFlash };
+
+// The SDP Sensor: the Catena 4801 M311 kit uses an SDP810-125Pa. If you
+// use a different sensor, change the product ID here.
+cSDPProduct<cSDP::ProductId_t::SDP810_125> gSDP { Wire };
 
-// The SDP Sensor
-cSDP gSDP { Wire, cSDP::Address::SDP8xx };
+// zero-offset corrections for the SDP, set by the "calibrate" command.
+cSDPCalibration gCalibration;
 
 // the measurement loop instance
 cMeasurementLoop gMeasurementLoop { gSDP };
@@ -77,6 +91,14 @@ cMeasurementLoop gMeasurementLoop { gSDP };
 // forward reference to the command functions
 cCommandStream::CommandFn cmdDebugFlags;
 cCommandStream::CommandFn cmdRunStop;
+cCommandStream::CommandFn cmdQuantile;
+cCommandStream::CommandFn cmdFilter;
+cCommandStream::CommandFn cmdCalibrate;
+cCommandStream::CommandFn cmdFlow;
+cCommandStream::CommandFn cmdReport;
+cCommandStream::CommandFn cmdFormat;
+cCommandStream::CommandFn cmdLog;
+cCommandStream::CommandFn cmdBackfill;
 
 // the individual commmands are put in this table
 static const cCommandStream::cEntry sMyExtraCommmands[] =
@@ -84,6 +106,14 @@ static const cCommandStream::cEntry sMyExtraCommmands[] =
         { "debugflags", cmdDebugFlags },
         { "run", cmdRunStop },
         { "stop", cmdRunStop },
+        { "quantile", cmdQuantile },
+        { "filter", cmdFilter },
+        { "calibrate", cmdCalibrate },
+        { "flow", cmdFlow },
+        { "report", cmdReport },
+        { "format", cmdFormat },
+        { "log", cmdLog },
+        { "backfill", cmdBackfill },
         // other commands go here....
         };
 
@@ -190,6 +220,17 @@ void setup_flash(void)
         gfFlash = true;
         gFlash.powerDown();
         gCatena.SafePrintf("FLASH found, put power down\n");
+
+        if (gFlashLog.begin())
+            {
+            gMeasurementLoop.setFlashLog(&gFlashLog);
+            gCatena.SafePrintf("flash log: records %lu to %lu\n",
+                (unsigned long) gFlashLog.getFirstSequence(),
+                (unsigned long) gFlashLog.getNextSequence()
+                );
+            }
+        else
+            gCatena.SafePrintf("flash log: begin() failed\n");
         }
     else
         {
@@ -207,10 +248,43 @@ void setup_radio()
     LMIC_setClockError(5 * MAX_CLOCK_ERROR / 100);
     }
 
+// restore the calibration table saved by saveCalibration(). deserialize()
+// checks the version and CRC, so if nothing was saved, the table stays
+// empty.
+static bool restoreCalibration()
+    {
+    cFram * const pFram = gCatena.getFram();
+    std::uint8_t buf[cSDPCalibration::kMaxSerializedSize];
+
+    if (pFram == nullptr)
+        return false;
+
+    pFram->read(kCalibrationFramOffset, buf, sizeof(buf));
+    return gCalibration.deserialize(buf, sizeof(buf));
+    }
+
+// save the calibration table to FRAM.
+static bool saveCalibration()
+    {
+    cFram * const pFram = gCatena.getFram();
+    std::uint8_t buf[cSDPCalibration::kMaxSerializedSize];
+    size_t const nBuf = gCalibration.serialize(buf, sizeof(buf));
+
+    if (pFram == nullptr || nBuf == 0)
+        return false;
+
+    return pFram->write(kCalibrationFramOffset, buf, nBuf);
+    }
+
 void setup_sensors()
     {
     Wire.begin();
-    if (! gSDP.begin())
+    if (restoreCalibration())
+        gCatena.SafePrintf("calibration: %u entries restored\n", gCalibration.getCount());
+    gSDP.setCalibration(&gCalibration);
+    // if the SDP is still waking up, the measurement engine finishes
+    // starting it later.
+    if (! gSDP.begin() && gSDP.getLastError() != cSDP::Error::WakeupPending)
         {
         gCatena.SafePrintf("gSDP.begin() failed %s(%u)\n",
                         gSDP.getLastErrorName(),
@@ -331,3 +405,626 @@ cCommandStream::CommandStatus cmdRunStop(
  
         return cCommandStream::CommandStatus::kSuccess;
         }
+
+/* process "quantile" */
+// argv[0] is the matched command name.
+// argv[1], if present, is the index of the quantile to set.
+// argv[2], if present, is the new quantile in permille.
+cCommandStream::CommandStatus cmdQuantile(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc < 2)
+            {
+            for (unsigned i = 0; i < cMeasurementLoop::kNumQuantiles; ++i)
+                pThis->printf("quantile %u: %u permille\n", i, gMeasurementLoop.getQuantile(i));
+            }
+        else if (argc != 3)
+            {
+            fResult = false;
+            pThis->printf("usage: quantile [index permille]\n");
+            }
+        else
+            {
+            std::uint32_t index, permille;
+            bool fOverflow;
+            size_t const nIndex = std::strlen(argv[1]);
+            size_t const nPermille = std::strlen(argv[2]);
+
+            if (nIndex != McciAdkLib_BufferToUint32(
+                                argv[1], nIndex,
+                                0,
+                                &index, &fOverflow
+                                ) || fOverflow ||
+                nPermille != McciAdkLib_BufferToUint32(
+                                argv[2], nPermille,
+                                0,
+                                &permille, &fOverflow
+                                ) || fOverflow ||
+                permille > 1000 ||
+                ! gMeasurementLoop.setQuantile(index, std::uint16_t(permille)))
+                {
+                pThis->printf("invalid quantile: %s %s\n", argv[1], argv[2]);
+                fResult = false;
+                }
+            else
+                {
+                pThis->printf("quantile %u is now %u permille\n", unsigned(index), unsigned(permille));
+                }
+            }
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "filter" */
+// argv[0] is the matched command name.
+// argv[1..3], if present, are the median width, EMA shift and decimation.
+cCommandStream::CommandStatus cmdFilter(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc == 4)
+            {
+            std::uint32_t v[3];
+            cSDPFilter::Config config;
+            bool fOverflow;
+
+            for (unsigned i = 0; i < 3 && fResult; ++i)
+                {
+                size_t const nArg = std::strlen(argv[i + 1]);
+
+                if (nArg != McciAdkLib_BufferToUint32(
+                                    argv[i + 1], nArg,
+                                    0,
+                                    &v[i], &fOverflow
+                                    ) || fOverflow || v[i] > 0xFF)
+                    {
+                    pThis->printf("invalid value: %s\n", argv[i + 1]);
+                    fResult = false;
+                    }
+                }
+
+            if (fResult)
+                {
+                config.MedianN = std::uint8_t(v[0]);
+                config.EmaShift = std::uint8_t(v[1]);
+                config.Decimation = std::uint8_t(v[2]);
+                if (! gMeasurementLoop.setFilterConfig(config))
+                    {
+                    pThis->printf("invalid filter configuration\n");
+                    fResult = false;
+                    }
+                }
+            }
+        else if (argc != 1)
+            {
+            fResult = false;
+            pThis->printf("usage: filter [median emaShift decimation]\n");
+            }
+
+        auto const &config = gMeasurementLoop.getFilterConfig();
+        pThis->printf("filter: median %u, EMA shift %u, decimation %u\n",
+            unsigned(config.MedianN),
+            unsigned(config.EmaShift),
+            unsigned(config.Decimation)
+            );
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+static void printCalibration(cCommandStream *pThis)
+        {
+        cSDPCalibration::Coefficients c;
+        std::uint64_t const serial = gSDP.getSerialNumber();
+
+        if (! gCalibration.getCoefficients(serial, c))
+            {
+            pThis->printf("no calibration for SDP %08lx%08lx\n",
+                (unsigned long)(serial >> 32), (unsigned long) serial
+                );
+            return;
+            }
+
+        pThis->printf("SDP %08lx%08lx: offset %ld mPa at %ld mC, tempco %ld/65536 mPa/C\n",
+            (unsigned long)(serial >> 32), (unsigned long) serial,
+            long(c.OffsetMilliPa), long(c.RefTempMilliC), long(c.TempCoQ16)
+            );
+        }
+
+/* process "calibrate" */
+// argv[0] is the matched command name.
+// argv[1], if present, is "zero", "drift" or "clear".
+// argv[2], if present, is the number of samples to average.
+cCommandStream::CommandStatus cmdCalibrate(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+        bool fChanged = false;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc < 2)
+            {
+            /* just print */
+            }
+        else if (argc > 3)
+            {
+            fResult = false;
+            pThis->printf("usage: calibrate [zero|drift [n] | clear]\n");
+            }
+        else if (! gMeasurementLoop.isInactive())
+            {
+            // the loop would compete with us for the sensor.
+            fResult = false;
+            pThis->printf("stop the measurement loop first\n");
+            }
+        else if (std::strcmp(argv[1], "clear") == 0 && argc == 2)
+            {
+            gCalibration.remove(gSDP.getSerialNumber());
+            fChanged = true;
+            }
+        else if (std::strcmp(argv[1], "zero") == 0 || std::strcmp(argv[1], "drift") == 0)
+            {
+            std::uint32_t nSamples = cSDPCalibration::kMaxAutoZeroSamples;
+            bool fOverflow;
+            cSDPCalibration::Coefficients c;
+
+            if (argc == 3)
+                {
+                size_t const nArg = std::strlen(argv[2]);
+
+                if (nArg != McciAdkLib_BufferToUint32(
+                                    argv[2], nArg,
+                                    0,
+                                    &nSamples, &fOverflow
+                                    ) || fOverflow || nSamples == 0 ||
+                    nSamples > cSDPCalibration::kMaxAutoZeroSamples)
+                    {
+                    // each sample blocks the LMIC, so keep it brief.
+                    pThis->printf("invalid sample count: %s (1 to %u)\n",
+                        argv[2], cSDPCalibration::kMaxAutoZeroSamples
+                        );
+                    fResult = false;
+                    }
+                }
+
+            // the ports must be equalized.
+            if (fResult)
+                {
+                pThis->printf("averaging %u samples\n", unsigned(nSamples));
+                if (! gCalibration.autoZero(gSDP, nSamples, argv[1][0] == 'd', c))
+                    {
+                    pThis->printf("measurement failed: %s(%u)\n",
+                        gSDP.getLastErrorName(),
+                        unsigned(gSDP.getLastError())
+                        );
+                    fResult = false;
+                    }
+                else if (! gCalibration.setCoefficients(c))
+                    {
+                    pThis->printf("calibration table full\n");
+                    fResult = false;
+                    }
+                else
+                    fChanged = true;
+                }
+            }
+        else
+            {
+            fResult = false;
+            pThis->printf("unknown subcommand: %s\n", argv[1]);
+            }
+
+        if (fChanged && ! saveCalibration())
+            {
+            pThis->printf("could not save calibration to FRAM\n");
+            fResult = false;
+            }
+
+        printCalibration(pThis);
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "flow" */
+// argv[0] is the matched command name.
+// argv[1], if present, is the element: "off", "pitot", "orifice" or "bypass".
+// argv[2], if present, is K * 1000.
+// argv[3], if present, is the area in mm^2 (not used for bypass).
+// argv[4], if present, is the ambient pressure in Pa.
+cCommandStream::CommandStatus cmdFlow(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        static const char * const kElementNames[] = { "off", "pitot", "orifice", "bypass" };
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc > 1)
+            {
+            cSDPFlow::Config config = gMeasurementLoop.getFlowConfig();
+            std::uint32_t v[3] = { 1000, config.AreaMm2, config.AmbientPressurePa };
+            unsigned iElement;
+
+            for (iElement = 0; iElement < sizeof(kElementNames) / sizeof(kElementNames[0]); ++iElement)
+                {
+                if (std::strcmp(argv[1], kElementNames[iElement]) == 0)
+                    break;
+                }
+            if (iElement >= sizeof(kElementNames) / sizeof(kElementNames[0]) || argc > 5)
+                {
+                pThis->printf("usage: flow [off | pitot|orifice|bypass [k1000 [area_mm2 [pressure_pa]]]]\n");
+                fResult = false;
+                }
+
+            for (int i = 2; i < argc && fResult; ++i)
+                {
+                bool fOverflow;
+                size_t const nArg = std::strlen(argv[i]);
+
+                if (nArg != McciAdkLib_BufferToUint32(
+                                    argv[i], nArg,
+                                    0,
+                                    &v[i - 2], &fOverflow
+                                    ) || fOverflow)
+                    {
+                    pThis->printf("invalid value: %s\n", argv[i]);
+                    fResult = false;
+                    }
+                }
+
+            if (fResult)
+                {
+                config.element = cSDPFlow::Element(iElement);
+                config.KFactorQ16 = std::uint32_t((std::uint64_t(v[0]) * 65536 + 500) / 1000);
+                config.AreaMm2 = v[1];
+                config.AmbientPressurePa = v[2];
+                if (! gMeasurementLoop.setFlowConfig(config))
+                    {
+                    pThis->printf("invalid flow configuration: K up to %lu/1000, area up to %lu mm2, pressure %lu to %lu Pa\n",
+                        (unsigned long)(cSDPFlow::kMaxKFactorQ16 / 65536 * 1000),
+                        (unsigned long) cSDPFlow::kMaxAreaMm2,
+                        (unsigned long) cSDPFlow::kMinAmbientPressurePa,
+                        (unsigned long) cSDPFlow::kMaxAmbientPressurePa
+                        );
+                    fResult = false;
+                    }
+                }
+            }
+
+        auto const &config = gMeasurementLoop.getFlowConfig();
+        pThis->printf("flow: %s, K %lu/1000, area %lu mm2, ambient %lu Pa\n",
+            kElementNames[unsigned(config.element)],
+            (unsigned long)((std::uint64_t(config.KFactorQ16) * 1000 + 32768) / 65536),
+            (unsigned long) config.AreaMm2,
+            (unsigned long) config.AmbientPressurePa
+            );
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "report" */
+// argv[0] is the matched command name.
+// argv[1], if present, is "timer" or "change".
+// argv[2], if present, is the sample interval in seconds.
+// argv[3], if present, is the absolute deadband in mPa.
+// argv[4], if present, is the relative deadband in permille.
+// argv[5], if present, is the heartbeat interval in seconds.
+cCommandStream::CommandStatus cmdReport(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc > 1)
+            {
+            cMeasurementLoop::ReportConfig config = gMeasurementLoop.getReportConfig();
+            std::uint32_t v[4] = { config.SampleSec, config.DeadbandMilliPa, config.DeadbandPermille, config.HeartbeatSec };
+
+            if (std::strcmp(argv[1], "timer") == 0 && argc == 2)
+                config.fOnChange = false;
+            else if (std::strcmp(argv[1], "change") == 0 && argc <= 6)
+                config.fOnChange = true;
+            else
+                {
+                pThis->printf("usage: report [timer | change [sample_sec [deadband_mpa [deadband_permille [heartbeat_sec]]]]]\n");
+                fResult = false;
+                }
+
+            for (int i = 2; i < argc && fResult; ++i)
+                {
+                bool fOverflow;
+                size_t const nArg = std::strlen(argv[i]);
+
+                if (nArg != McciAdkLib_BufferToUint32(
+                                    argv[i], nArg,
+                                    0,
+                                    &v[i - 2], &fOverflow
+                                    ) || fOverflow)
+                    {
+                    pThis->printf("invalid value: %s\n", argv[i]);
+                    fResult = false;
+                    }
+                }
+
+            if (fResult && v[2] > 1000)
+                {
+                pThis->printf("deadband out of range: %lu\n", (unsigned long) v[2]);
+                fResult = false;
+                }
+
+            if (fResult)
+                {
+                config.SampleSec = v[0];
+                config.DeadbandMilliPa = v[1];
+                config.DeadbandPermille = std::uint16_t(v[2]);
+                config.HeartbeatSec = v[3];
+                if (! gMeasurementLoop.setReportConfig(config))
+                    {
+                    pThis->printf("invalid report configuration\n");
+                    fResult = false;
+                    }
+                }
+            }
+
+        auto const &config = gMeasurementLoop.getReportConfig();
+        if (! config.fOnChange)
+            pThis->printf("report: timer\n");
+        else
+            pThis->printf("report: change, sample %lu s, deadband %lu mPa or %u/1000, heartbeat %lu s\n",
+                (unsigned long) config.SampleSec,
+                (unsigned long) config.DeadbandMilliPa,
+                unsigned(config.DeadbandPermille),
+                (unsigned long) config.HeartbeatSec
+                );
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "format" */
+// argv[0] is the matched command name.
+// argv[1], if present, is "stats" (format 0x21) or "series" (format 0x22).
+// argv[2], if present, is the number of samples per series uplink.
+// argv[3], if present, is the series resolution in mPa.
+cCommandStream::CommandStatus cmdFormat(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc > 1)
+            {
+            std::uint8_t format = cMeasurementLoop::kMessageFormat;
+            std::uint32_t v[2] = { gMeasurementLoop.getSeriesLength(), gMeasurementLoop.getSeriesResolution() };
+
+            if (std::strcmp(argv[1], "stats") == 0 && argc == 2)
+                format = cMeasurementLoop::kMessageFormat;
+            else if (std::strcmp(argv[1], "series") == 0 && argc <= 4)
+                format = cMeasurementLoop::kSeriesMessageFormat;
+            else
+                {
+                pThis->printf("usage: format [stats | series [length [resolution_mpa]]]\n");
+                fResult = false;
+                }
+
+            for (int i = 2; i < argc && fResult; ++i)
+                {
+                bool fOverflow;
+                size_t const nArg = std::strlen(argv[i]);
+
+                if (nArg != McciAdkLib_BufferToUint32(
+                                    argv[i], nArg,
+                                    0,
+                                    &v[i - 2], &fOverflow
+                                    ) || fOverflow)
+                    {
+                    pThis->printf("invalid value: %s\n", argv[i]);
+                    fResult = false;
+                    }
+                }
+
+            if (fResult && ! gMeasurementLoop.setMessageFormat(format, v[0], v[1]))
+                {
+                pThis->printf("invalid format: length 1..%u, resolution a multiple of 10 mPa up to 2550\n",
+                    cMeasurementLoop::kMaxSeriesLength
+                    );
+                fResult = false;
+                }
+            }
+
+        if (gMeasurementLoop.getMessageFormat() == cMeasurementLoop::kSeriesMessageFormat)
+            pThis->printf("format: series (0x%02x), %u samples every %lu s, resolution %lu mPa\n",
+                unsigned(cMeasurementLoop::kSeriesMessageFormat),
+                gMeasurementLoop.getSeriesLength(),
+                (unsigned long) gMeasurementLoop.getReportConfig().SampleSec,
+                (unsigned long) gMeasurementLoop.getSeriesResolution()
+                );
+        else
+            pThis->printf("format: stats (0x%02x)\n", unsigned(cMeasurementLoop::kMessageFormat));
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "log" */
+// argv[0] is the matched command name.
+// argv[1], if present, is "dump" or "erase".
+// argv[2], if present, is the number of records to dump, newest last.
+cCommandStream::CommandStatus cmdLog(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        if (! gFlashLog.isReady())
+            {
+            pThis->printf("no flash log\n");
+            return cCommandStream::CommandStatus::kError;
+            }
+
+        fResult = true;
+        if (argc == 1)
+            ;
+        else if (std::strcmp(argv[1], "erase") == 0 && argc == 2)
+            {
+            if (! gFlashLog.erase())
+                {
+                pThis->printf("erase failed\n");
+                fResult = false;
+                }
+            }
+        else if (std::strcmp(argv[1], "dump") == 0 && argc <= 3)
+            {
+            std::uint32_t nDump = 10;
+
+            if (argc > 2)
+                {
+                bool fOverflow;
+                size_t const nArg = std::strlen(argv[2]);
+
+                if (nArg != McciAdkLib_BufferToUint32(
+                                    argv[2], nArg,
+                                    0,
+                                    &nDump, &fOverflow
+                                    ) || fOverflow)
+                    {
+                    pThis->printf("invalid value: %s\n", argv[2]);
+                    fResult = false;
+                    }
+                }
+
+            std::uint32_t const first = gFlashLog.getFirstSequence();
+            std::uint32_t const next = gFlashLog.getNextSequence();
+            std::uint32_t seq = next - first > nDump ? next - nDump : first;
+
+            for (; fResult && seq != next; ++seq)
+                {
+                cFlashLog::Record r;
+
+                if (! gFlashLog.read(seq, r))
+                    pThis->printf("%lu: damaged\n", (unsigned long) seq);
+                else
+                    pThis->printf("%lu: boot %lu +%lu s: dp %ld (%ld..%ld) mPa, n %u, t %ld mC\n",
+                        (unsigned long) r.Sequence,
+                        (unsigned long) r.BootCount,
+                        (unsigned long) r.Seconds,
+                        (long) r.DpMeanMilliPa,
+                        (long) r.DpMinMilliPa,
+                        (long) r.DpMaxMilliPa,
+                        unsigned(r.nSamples),
+                        (long) r.TMeanMilliC
+                        );
+                }
+            }
+        else
+            {
+            pThis->printf("usage: log [dump [count] | erase]\n");
+            fResult = false;
+            }
+
+        pThis->printf("log: records %lu to %lu, %lu sectors\n",
+            (unsigned long) gFlashLog.getFirstSequence(),
+            (unsigned long) gFlashLog.getNextSequence(),
+            (unsigned long) gFlashLog.getSectorCount()
+            );
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
+
+/* process "backfill" */
+// argv[0] is the matched command name.
+// argv[1], if present, is the most backfill uplinks after each uplink.
+cCommandStream::CommandStatus cmdBackfill(
+        cCommandStream *pThis,
+        void *pContext,
+        int argc,
+        char **argv
+        )
+        {
+        bool fResult;
+
+        pThis->printf("%s\n", argv[0]);
+        fResult = true;
+        if (argc > 2)
+            {
+            pThis->printf("usage: backfill [uplinks]\n");
+            fResult = false;
+            }
+        else if (argc > 1)
+            {
+            std::uint32_t nUplinks;
+            bool fOverflow;
+            size_t const nArg = std::strlen(argv[1]);
+
+            if (nArg != McciAdkLib_BufferToUint32(
+                                argv[1], nArg,
+                                0,
+                                &nUplinks, &fOverflow
+                                ) || fOverflow || nUplinks > 0xFF)
+                {
+                pThis->printf("invalid value: %s\n", argv[1]);
+                fResult = false;
+                }
+            else
+                gMeasurementLoop.setBackfillLimit(std::uint8_t(nUplinks));
+            }
+
+        pThis->printf("backfill: up to %u uplinks after each uplink; %u points in RAM, %lu in flash\n",
+            unsigned(gMeasurementLoop.getBackfillLimit()),
+            gMeasurementLoop.getBacklogCount(),
+            (unsigned long) gMeasurementLoop.getBacklogFlashCount()
+            );
+
+        return fResult ? cCommandStream::CommandStatus::kSuccess
+                       : cCommandStream::CommandStatus::kInvalidParameter
+                       ;
+        }
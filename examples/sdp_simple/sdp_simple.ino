@@ -151,9 +151,14 @@ void loop()
     fLed = !fLed;
     digitalWrite(LED_BUILTIN, fLed);
 
-    // start a measurement
-    if (! gSdp.startTriggeredMeasurement())
-        printFailure("gSdp.startTriggeredMeasurement failed");
+    // start a measurement. After sleep(), the sensor may not answer
+    // the first wakeup; if so, the driver asks us to try again shortly.
+    while (! gSdp.startTriggeredMeasurement())
+        {
+        if (gSdp.getLastError() != cSDP::Error::WakeupPending)
+            printFailure("gSdp.startTriggeredMeasurement failed");
+        delay(1);
+        }
 
     // wait for measurement to complete.
     while (! gSdp.queryReady())
@@ -0,0 +1,196 @@
+/*
+
+Module: sdp-crc-bench.cpp
+
+Function:
+    Compare the CRC engines of the Catena SDP library on a host.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include <MCCI_Catena_SDP_Crc.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace McciCatenaSdp;
+
+/****************************************************************************\
+|
+|   Reference implementation: one bit at a time, straight from the datasheet.
+|
+\****************************************************************************/
+
+static std::uint8_t crcBitwise(const std::uint8_t *buf, std::size_t nBuf)
+    {
+    std::uint8_t crc8 = cCrc8::kInit;
+
+    for (std::size_t i = 0; i < nBuf; ++i)
+        {
+        crc8 ^= buf[i];
+        for (unsigned bit = 0; bit < 8; ++bit)
+            crc8 = (crc8 & 0x80) ? std::uint8_t((crc8 << 1) ^ cCrc8::kPoly)
+                                 : std::uint8_t(crc8 << 1);
+        }
+
+    return crc8;
+    }
+
+/****************************************************************************\
+|
+|   The benchmark
+|
+\****************************************************************************/
+
+// a burst of 3-byte words, with good CRCs.
+static std::vector<std::uint8_t> makeBurst(std::size_t nWords)
+    {
+    std::vector<std::uint8_t> burst(nWords * cCrc8::kBytesPerWord);
+    std::uint32_t seed = 0x5D9u;
+
+    for (std::size_t i = 0; i < nWords; ++i)
+        {
+        std::uint8_t * const p = &burst[i * cCrc8::kBytesPerWord];
+
+        seed = seed * 1664525u + 1013904223u;
+        p[0] = std::uint8_t(seed >> 24);
+        p[1] = std::uint8_t(seed >> 16);
+        p[2] = crcBitwise(p, 2);
+        }
+
+    return burst;
+    }
+
+// check that every engine agrees with the reference for every word.
+static bool checkEngines()
+    {
+    unsigned nErrors = 0;
+
+    for (unsigned w = 0; w < 0x10000; ++w)
+        {
+        const std::uint8_t word[2] = { std::uint8_t(w >> 8), std::uint8_t(w) };
+        const std::uint8_t ref = crcBitwise(word, 2);
+
+        if (cCrc8::crcNibble(word, 2) != ref ||
+            cCrc8::crcByte(word, 2) != ref ||
+            cCrc8::crcWord(word[0], word[1]) != ref)
+            {
+            if (++nErrors <= 5)
+                std::printf("mismatch for word %04x\n", w);
+            }
+        }
+
+    return nErrors == 0;
+    }
+
+// check that validateBurst() finds the first bad word.
+static bool checkBatch()
+    {
+    std::vector<std::uint8_t> burst = makeBurst(9);
+
+    if (cCrc8::validateBurst(burst.data(), 9) != cCrc8::kBatchSuccess)
+        return false;
+
+    for (std::size_t iBad = 0; iBad < 9; ++iBad)
+        {
+        std::vector<std::uint8_t> bad = burst;
+
+        bad[iBad * cCrc8::kBytesPerWord + (iBad % 3)] ^= 0x10;
+        if (cCrc8::validateBurst(bad.data(), 9) != iBad)
+            return false;
+        }
+
+    return true;
+    }
+
+// time one engine over the burst, repeated nLoops times. The volatile sink
+// keeps the compiler from discarding the work.
+static volatile std::uint32_t gSink;
+
+template <typename F>
+static double timeEngine(const std::vector<std::uint8_t> &burst, unsigned nLoops, F f)
+    {
+    const std::size_t nWords = burst.size() / cCrc8::kBytesPerWord;
+    std::uint32_t nBad = 0;
+
+    const auto tStart = std::chrono::steady_clock::now();
+    for (unsigned loop = 0; loop < nLoops; ++loop)
+        {
+        const std::uint8_t *p = burst.data();
+
+        for (std::size_t i = 0; i < nWords; ++i, p += cCrc8::kBytesPerWord)
+            nBad += f(p) != p[2];
+        }
+    const auto tEnd = std::chrono::steady_clock::now();
+
+    gSink = nBad;
+    return std::chrono::duration<double, std::nano>(tEnd - tStart).count()
+            / (double(nWords) * nLoops);
+    }
+
+int main(int argc, char **argv)
+    {
+    unsigned nLoops = 2000;
+
+    if (argc > 1)
+        nLoops = unsigned(std::strtoul(argv[1], nullptr, 0));
+    if (nLoops == 0)
+        nLoops = 1;
+
+    if (! checkEngines())
+        {
+        std::printf("CRC engines disagree with the reference\n");
+        return 1;
+        }
+    if (! checkBatch())
+        {
+        std::printf("validateBurst() did not find the bad word\n");
+        return 1;
+        }
+
+    const std::vector<std::uint8_t> burst = makeBurst(4096);
+
+    std::printf("selected engine: %u\n", unsigned(cCrc8::kEngine));
+    std::printf("%-24s %10s\n", "engine", "ns/word");
+    std::printf("%-24s %10.2f\n", "bitwise (reference)",
+        timeEngine(burst, nLoops,
+            [](const std::uint8_t *p) { return crcBitwise(p, 2); }));
+    std::printf("%-24s %10.2f\n", "nibble table",
+        timeEngine(burst, nLoops,
+            [](const std::uint8_t *p) { return cCrc8::crcNibble(p, 2); }));
+    std::printf("%-24s %10.2f\n", "byte table",
+        timeEngine(burst, nLoops,
+            [](const std::uint8_t *p) { return cCrc8::crcByte(p, 2); }));
+    std::printf("%-24s %10.2f\n", "word table",
+        timeEngine(burst, nLoops,
+            [](const std::uint8_t *p) { return cCrc8::crcWord(p[0], p[1]); }));
+
+    // the batch validator, over the whole burst at once.
+    const std::size_t nWords = burst.size() / cCrc8::kBytesPerWord;
+    std::size_t result = 0;
+
+    const auto tStart = std::chrono::steady_clock::now();
+    for (unsigned loop = 0; loop < nLoops; ++loop)
+        result ^= cCrc8::validateBurst(burst.data(), nWords);
+    const auto tEnd = std::chrono::steady_clock::now();
+
+    gSink = std::uint32_t(result);
+    std::printf("%-24s %10.2f\n", "validateBurst()",
+        std::chrono::duration<double, std::nano>(tEnd - tStart).count()
+            / (double(nWords) * nLoops));
+
+    return 0;
+    }
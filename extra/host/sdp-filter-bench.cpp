@@ -0,0 +1,259 @@
+/*
+
+Module: sdp-filter-bench.cpp
+
+Function:
+    Check and time the stages of the Catena SDP filter chain on a host.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include <MCCI_Catena_SDP_Filter.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace McciCatenaSdp;
+
+/****************************************************************************\
+|
+|   The test signal
+|
+\****************************************************************************/
+
+// a steady DP of 50 Pa, in mPa, with fan ripple of +/- 2 Pa, uniform
+// noise of +/- 0.3 Pa, and a 20 Pa spike in about one reading in a hundred.
+static constexpr std::int32_t kTrueDp = 50000;
+
+static std::vector<std::int32_t> makeSignal(std::size_t n)
+    {
+    std::vector<std::int32_t> signal(n);
+    std::uint32_t seed = 0x5D9u;
+
+    for (std::size_t i = 0; i < n; ++i)
+        {
+        seed = seed * 1664525u + 1013904223u;
+
+        std::int32_t v = kTrueDp;
+        v += std::int32_t(std::lround(2000.0 * std::sin(double(i) * 0.9)));
+        v += std::int32_t(seed >> 16) % 601 - 300;
+        if ((seed >> 8) % 100 == 0)
+            v += 20000;
+
+        signal[i] = v;
+        }
+
+    return signal;
+    }
+
+/****************************************************************************\
+|
+|   Checks
+|
+\****************************************************************************/
+
+static bool configure(cSDPFilter &f, unsigned medianN, unsigned emaShift, unsigned decimation)
+    {
+    cSDPFilter::Config config;
+
+    config.MedianN = std::uint8_t(medianN);
+    config.EmaShift = std::uint8_t(emaShift);
+    config.Decimation = std::uint8_t(decimation);
+    return f.configure(config);
+    }
+
+// the median stage against a sort of the same window.
+static bool checkMedian(const std::vector<std::int32_t> &signal)
+    {
+    for (unsigned medianN = 3; medianN <= cSDPFilter::kMaxMedianN; medianN += 2)
+        {
+        cSDPFilter f;
+
+        if (! configure(f, medianN, 0, 1))
+            return false;
+
+        for (std::size_t i = 0; i < 1000; ++i)
+            {
+            const std::size_t iFirst = i + 1 >= medianN ? i + 1 - medianN : 0;
+            std::vector<std::int32_t> window(signal.begin() + iFirst, signal.begin() + i + 1);
+            std::int32_t out;
+
+            std::sort(window.begin(), window.end());
+            if (! f.put(signal[i], out) || out != window[window.size() / 2])
+                {
+                std::printf("median-%u wrong at reading %zu\n", medianN, i);
+                return false;
+                }
+            }
+        }
+
+    return true;
+    }
+
+// the EMA must settle on a step exactly, from either side, and the
+// decimator must output the rounded mean of each group.
+static bool checkEmaAndDecimator()
+    {
+    cSDPFilter f;
+    std::int32_t out = 0;
+
+    for (std::int32_t step : { 12345, -12345 })
+        {
+        if (! configure(f, 0, 4, 1))
+            return false;
+
+        f.put(0, out);
+        for (unsigned i = 0; i < 1000; ++i)
+            f.put(step, out);
+
+        if (out != step)
+            {
+            std::printf("EMA settled at %d, not %d\n", int(out), int(step));
+            return false;
+            }
+        }
+
+    if (! configure(f, 0, 0, 4))
+        return false;
+
+    const std::int32_t in[] = { 1, 2, 3, 5, -1, -2, -3, -5 };
+    const std::int32_t expect[] = { 3, -3 };
+    unsigned nOut = 0;
+
+    for (auto v : in)
+        {
+        if (f.put(v, out))
+            {
+            if (nOut >= 2 || out != expect[nOut])
+                return false;
+            ++nOut;
+            }
+        }
+
+    return nOut == 2 && ! configure(f, 4, 0, 1) && ! configure(f, 9, 0, 1);
+    }
+
+/****************************************************************************\
+|
+|   The benchmark
+|
+\****************************************************************************/
+
+static volatile std::int32_t gSink;
+
+struct Result
+    {
+    double nsPerReading;
+    double rmsError;
+    std::size_t nOut;
+    };
+
+// time the chain over the signal, repeated nLoops times; then measure the
+// RMS error of its output against the true DP, skipping the first outputs
+// while the filter settles.
+static Result runChain(const std::vector<std::int32_t> &signal, unsigned nLoops,
+                       unsigned medianN, unsigned emaShift, unsigned decimation)
+    {
+    cSDPFilter f;
+    Result result;
+    std::int32_t out = 0;
+    std::int32_t acc = 0;
+
+    configure(f, medianN, emaShift, decimation);
+
+    const auto tStart = std::chrono::steady_clock::now();
+    for (unsigned loop = 0; loop < nLoops; ++loop)
+        {
+        for (auto v : signal)
+            {
+            if (f.put(v, out))
+                acc += out;
+            }
+        }
+    const auto tEnd = std::chrono::steady_clock::now();
+
+    gSink = acc;
+    result.nsPerReading = std::chrono::duration<double, std::nano>(tEnd - tStart).count()
+                            / (double(signal.size()) * nLoops);
+
+    double sumSq = 0;
+    f.reset();
+    result.nOut = 0;
+    for (std::size_t i = 0; i < signal.size(); ++i)
+        {
+        if (f.put(signal[i], out) && i >= 200)
+            {
+            const double e = double(out) - kTrueDp;
+
+            sumSq += e * e;
+            ++result.nOut;
+            }
+        }
+    result.rmsError = result.nOut == 0 ? 0 : std::sqrt(sumSq / result.nOut);
+
+    return result;
+    }
+
+int main(int argc, char **argv)
+    {
+    unsigned nLoops = 200;
+
+    if (argc > 1)
+        nLoops = unsigned(std::strtoul(argv[1], nullptr, 0));
+    if (nLoops == 0)
+        nLoops = 1;
+
+    const std::vector<std::int32_t> signal = makeSignal(10000);
+
+    if (! checkMedian(signal))
+        {
+        std::printf("median stage disagrees with the reference\n");
+        return 1;
+        }
+    if (! checkEmaAndDecimator())
+        {
+        std::printf("EMA or decimator stage is wrong\n");
+        return 1;
+        }
+
+    static const struct
+        {
+        const char *pName;
+        unsigned medianN, emaShift, decimation;
+        } kCases[] =
+        {
+        { "bypass",                 0, 0, 1 },
+        { "median-3",               3, 0, 1 },
+        { "median-5",               5, 0, 1 },
+        { "median-7",               7, 0, 1 },
+        { "ema >> 3",               0, 3, 1 },
+        { "decimate / 8",           0, 0, 8 },
+        { "median-5, ema >> 3",     5, 3, 1 },
+        { "median-5, ema >> 3, / 8", 5, 3, 8 },
+        };
+
+    std::printf("%-26s %10s %12s %8s\n", "chain", "ns/reading", "rms err mPa", "outputs");
+    for (auto const &c : kCases)
+        {
+        const Result r = runChain(signal, nLoops, c.medianN, c.emaShift, c.decimation);
+
+        std::printf("%-26s %10.2f %12.1f %8zu\n", c.pName, r.nsPerReading, r.rmsError, r.nOut);
+        }
+
+    return 0;
+    }
@@ -0,0 +1,368 @@
+/*
+
+Module: sdp-host-bench.cpp
+
+Function:
+    Run and profile the Catena SDP driver against simulated sensors.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include "sdp_host_sim.h"
+
+#include <MCCI_Catena_SDP_Async.h>
+#include <MCCI_Catena_SDP_Calibration.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace McciCatenaSdp;
+using namespace SdpHostSim;
+
+/****************************************************************************\
+|
+|   The test fixture: a clock, a bus, one device and the driver.
+|
+\****************************************************************************/
+
+struct Fixture
+    {
+    cSimClock clock;
+    cSimBus bus { clock };
+    cSimSdp device;
+    cSDP sdp;
+
+    Fixture(const cSimSdp::Config &config)
+        : device(config)
+        , sdp(bus, clock, cSDP::Address(config.Address))
+        {
+        bus.attach(device);
+        device.setValues(42.5f, 23.0f);
+        device.setNoise(0.5f);
+        }
+    };
+
+// the result of running one scenario.
+class cScenario
+    {
+public:
+    cScenario(const char *pName, Fixture &f)
+        : m_pName(pName)
+        , m_f(f)
+        {
+        f.bus.resetStats();
+        this->m_tSim0 = f.clock.getMicros();
+        this->m_tHost0 = std::chrono::steady_clock::now();
+        }
+
+    void report(unsigned nOps, unsigned nFailures)
+        {
+        const auto tHost = std::chrono::steady_clock::now() - this->m_tHost0;
+        const double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(tHost).count());
+        const auto &stats = this->m_f.bus.getStats();
+        const double n = nOps == 0 ? 1.0 : double(nOps);
+
+        std::printf("%-28s %6u %9.0f %7.2f %7.2f %9.1f %9.2f %6u\n",
+            this->m_pName,
+            nOps,
+            ns / n,
+            stats.Transactions / n,
+            (stats.BytesRead + stats.BytesWritten) / n,
+            stats.BusTimeUs / n,
+            (this->m_f.clock.getMicros() - this->m_tSim0) / 1000.0 / n,
+            nFailures
+            );
+        }
+
+private:
+    const char *m_pName;
+    Fixture &m_f;
+    std::uint64_t m_tSim0;
+    std::chrono::steady_clock::time_point m_tHost0;
+    };
+
+// the application's idle time between polls, in microseconds.
+static constexpr std::uint64_t kPollUs = 250;
+
+// call fn until it stops returning WakeupPending, polling like an
+// application would.
+template <typename Fn>
+static bool retryWakeup(Fixture &f, Fn fn)
+    {
+    while (! fn())
+        {
+        if (f.sdp.getLastError() != cSDP::Error::WakeupPending)
+            return false;
+        f.clock.advanceUs(kPollUs);
+        }
+    return true;
+    }
+
+static bool triggeredCycle(Fixture &f)
+    {
+    if (! retryWakeup(f, [&f]() { return f.sdp.startTriggeredMeasurement(); }))
+        return false;
+
+    while (! f.sdp.queryReady())
+        {
+        if (f.sdp.getLastError() != cSDP::Error::Busy)
+            return false;
+        f.clock.advanceUs(kPollUs);
+        }
+
+    return f.sdp.readMeasurement();
+    }
+
+/****************************************************************************\
+|
+|   The scenarios
+|
+\****************************************************************************/
+
+static void runProduct(const char *pTitle, const cSimSdp::Config &config, unsigned nIter)
+    {
+    Fixture f(config);
+    unsigned nFail;
+
+    std::printf("\n%s\n", pTitle);
+    std::printf("%-28s %6s %9s %7s %7s %9s %9s %6s\n",
+        "scenario", "n", "host ns", "xact", "bytes", "bus us", "sim ms", "fail");
+
+        {
+        cScenario s("begin()", f);
+        nFail = retryWakeup(f, [&f]() { return f.sdp.begin(); }) ? 0 : 1;
+        s.report(1, nFail);
+        if (nFail)
+            {
+            std::printf("begin failed: %s\n", f.sdp.getLastErrorName());
+            return;
+            }
+        }
+
+        {
+        cScenario s("end() + begin() (cold)", f);
+        nFail = 0;
+        for (unsigned i = 0; i < nIter; ++i)
+            {
+            f.sdp.end();
+            f.sdp.invalidateProductInfo();
+            nFail += retryWakeup(f, [&f]() { return f.sdp.begin(); }) ? 0 : 1;
+            }
+        s.report(nIter, nFail);
+        }
+
+        {
+        cScenario s("end() + begin() (warm)", f);
+        nFail = 0;
+        for (unsigned i = 0; i < nIter; ++i)
+            {
+            f.sdp.end();
+            nFail += retryWakeup(f, [&f]() { return f.sdp.begin(); }) ? 0 : 1;
+            }
+        s.report(nIter, nFail);
+        }
+
+        {
+        // restoring the wrong product must fall back to full identification.
+        cScenario s("begin() (stale product)", f);
+        cSDP::ProductInfo info;
+        nFail = f.sdp.getProductInfo(info) ? 0 : 1;
+        f.sdp.end();
+        const auto goodInfo = info;
+        info.ProductNumber ^= 0x00000100;
+        f.sdp.setProductInfo(info);
+        nFail += retryWakeup(f, [&f]() { return f.sdp.begin(); }) ? 0 : 1;
+        nFail += (f.sdp.getProductInfo(info) && info.ProductNumber == goodInfo.ProductNumber) ? 0 : 1;
+        s.report(1, nFail);
+        }
+
+        {
+        cScenario s("triggered (poll)", f);
+        nFail = 0;
+        for (unsigned i = 0; i < nIter; ++i)
+            nFail += triggeredCycle(f) ? 0 : 1;
+        s.report(nIter, nFail);
+        std::printf("  learned conversion estimate: %u ms\n", unsigned(f.sdp.getConversionEstimateMs()));
+        }
+
+        {
+        cScenario s("triggered (DP-only read)", f);
+        f.sdp.setReadProfile(cSDP::ReadProfile::DiffPressure, 10);
+        nFail = 0;
+        for (unsigned i = 0; i < nIter; ++i)
+            nFail += triggeredCycle(f) ? 0 : 1;
+        f.sdp.setReadProfile(cSDP::ReadProfile::Full);
+        s.report(nIter, nFail);
+        }
+
+        {
+        cScenario s("measureBlocking()", f);
+        nFail = 0;
+        for (unsigned i = 0; i < nIter; ++i)
+            nFail += f.sdp.measureBlocking() ? 0 : 1;
+        s.report(nIter, nFail);
+        }
+
+        {
+        cScenario s("continuous, 2 ms spacing", f);
+        nFail = f.sdp.startContinuousMeasurement(cSDP::Averaging::Average) ? 0 : 1;
+        f.clock.delay(cSDP::kContinuousStartupMs);
+        for (unsigned i = 0; i < nIter; ++i)
+            {
+            if (! (f.sdp.queryReady() && f.sdp.readMeasurement()))
+                ++nFail;
+            cSDP::MeasurementRaw m;
+            while (f.sdp.getSample(m))
+                /* discard */;
+            f.clock.advanceUs(2000);
+            }
+        nFail += f.sdp.stopContinuousMeasurement() ? 0 : 1;
+        s.report(nIter, nFail);
+        }
+
+        {
+        cScenario s("sleep() + triggered", f);
+        nFail = 0;
+        for (unsigned i = 0; i < nIter; ++i)
+            {
+            nFail += f.sdp.sleep() ? 0 : 1;
+            nFail += triggeredCycle(f) ? 0 : 1;
+            }
+        s.report(nIter, nFail);
+        }
+
+        {
+        // queue requests in threes, with sleep after the last; the engine
+        // does all the sequencing under poll().
+        cScenario s("cSDPAsync, sleep after 3", f);
+        cSDPAsync engine { f.sdp };
+        unsigned nDone = 0;
+        auto const cb =
+            [](void *pClientData, cSDP &, bool fSuccess)
+                {
+                *(unsigned *)pClientData += fSuccess ? 1 : 0;
+                };
+
+        for (unsigned i = 0; i < nIter; ++i)
+            {
+            engine.requestMeasurement(cb, &nDone, (i % 3) == 2);
+            if ((i % 3) == 2 || i == nIter - 1)
+                {
+                while (! engine.isIdle())
+                    {
+                    engine.poll();
+                    f.clock.advanceUs(kPollUs);
+                    }
+                }
+            }
+        s.report(nIter, nIter - nDone);
+        }
+
+        {
+        cScenario s("triggered, 1% CRC faults", f);
+        cSimSdp::Faults faults {};
+        faults.CrcErrorPpm = 10000;
+        f.device.setFaults(faults);
+        nFail = 0;
+        for (unsigned i = 0; i < nIter; ++i)
+            nFail += triggeredCycle(f) ? 0 : 1;
+        f.device.setFaults(cSimSdp::Faults {});
+        s.report(nIter, nFail);
+        }
+
+    // calibration: the device reads 0.35 Pa with its ports equalized at
+    // 23 C, and 0.55 Pa at 33 C. Auto-zero at both temperatures; then at
+    // 28 C, with a true DP of 10 Pa, the corrected reading should be
+    // close to 10 Pa.
+    cSDPCalibration calibration;
+    cSDPCalibration::Coefficients coeff;
+    bool fCalOk;
+
+    f.device.setNoise(0.05f);
+    f.device.setValues(0.35f, 23.0f);
+    fCalOk = calibration.autoZero(f.sdp, cSDPCalibration::kMaxAutoZeroSamples, true, coeff) && calibration.setCoefficients(coeff);
+    f.device.setValues(0.55f, 33.0f);
+    fCalOk = fCalOk && calibration.autoZero(f.sdp, cSDPCalibration::kMaxAutoZeroSamples, true, coeff) && calibration.setCoefficients(coeff);
+
+    // the table must survive a round trip through its serialized form.
+    std::uint8_t calBuf[cSDPCalibration::kMaxSerializedSize];
+    const size_t nCalBuf = calibration.serialize(calBuf, sizeof(calBuf));
+    fCalOk = fCalOk && calibration.deserialize(calBuf, nCalBuf);
+
+    f.sdp.setCalibration(&calibration);
+    f.device.setValues(10.45f, 28.0f);
+
+        {
+        cScenario s("triggered, calibrated", f);
+        nFail = 0;
+        for (unsigned i = 0; i < nIter; ++i)
+            nFail += triggeredCycle(f) ? 0 : 1;
+        s.report(nIter, nFail);
+        }
+
+    // the raw data isn't corrected.
+    auto const mRaw = f.sdp.getRawMeasurement();
+
+    std::printf("  calibration %s: offset %d mPa at %d mC, tempco %.1f mPa/C; reading at 28 C %.3f Pa (true 10.000, raw %.3f)\n",
+        fCalOk ? "ok" : "FAILED",
+        int(coeff.OffsetMilliPa), int(coeff.RefTempMilliC),
+        coeff.TempCoQ16 / 65536.0,
+        f.sdp.getDifferentialPressure(),
+        cSDP::rawDiffPtoPascal(mRaw.DifferentialPressureBits, mRaw.ScaleBits)
+        );
+
+    f.sdp.setCalibration(nullptr);
+    f.device.setValues(42.5f, 23.0f);
+    f.device.setNoise(0.5f);
+    triggeredCycle(f);
+
+    auto const m = f.sdp.getMeasurement();
+    std::printf("  last reading: %s serial %llx: T=%.2f C, DP=%.3f Pa\n",
+        f.sdp.getProductName(),
+        (unsigned long long) f.sdp.getSerialNumber(),
+        m.Temperature,
+        m.DifferentialPressure
+        );
+
+    // the driver's own telemetry, if compiled in.
+    cSDP::Metrics metrics;
+    if (f.sdp.getMetrics(metrics))
+        {
+        std::printf("  driver metrics: %u xact, %u bytes, %u NACKs, %u short, %u long, %u CRC, %u wake retries, %u busy polls\n",
+            unsigned(metrics.nTransactions), unsigned(metrics.nBytes), unsigned(metrics.nNacks),
+            unsigned(metrics.nShortReads), unsigned(metrics.nLongReads), unsigned(metrics.nCrcErrors),
+            unsigned(metrics.nWakeRetries), unsigned(metrics.nBusyPolls)
+            );
+        std::printf("  latency: %u..%u ms; histogram:", unsigned(metrics.LatencyMinMs), unsigned(metrics.LatencyMaxMs));
+        for (auto v : metrics.LatencyHist)
+            std::printf(" %u", unsigned(v));
+        std::printf("\n");
+        }
+    }
+
+int main(int argc, char **argv)
+    {
+    unsigned nIter = 1000;
+
+    if (argc > 1)
+        nIter = unsigned(std::strtoul(argv[1], nullptr, 0));
+
+    std::printf("SDP driver host benchmark: %u iterations per scenario\n", nIter);
+    std::printf("(xact, bytes and bus us are per operation; sim ms is simulated elapsed time)\n");
+
+    runProduct("SDP31", cSimSdp::configSDP31(), nIter);
+    runProduct("SDP810-125Pa", cSimSdp::configSDP810_125(), nIter);
+    return 0;
+    }
@@ -0,0 +1,119 @@
+/*
+
+Module: sdp-simple-test.cpp
+
+Function:
+    Run the measurement loop of the sdp_simple example against simulated
+    sensors.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include "sdp_host_sim.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace McciCatenaSdp;
+using namespace SdpHostSim;
+
+/****************************************************************************\
+|
+|   One pass of sdp_simple's loop(): start, wait, read, sleep. Failures
+|   that the sketch would report with printFailure() end the pass.
+|
+\****************************************************************************/
+
+static bool loopOnce(cSimClock &clock, cSDP &sdp, unsigned iPass)
+    {
+    // bound the waits, so a regression fails rather than hangs.
+    static constexpr unsigned kMaxTries = 1000;
+    unsigned nTries;
+
+    for (nTries = 0; ! sdp.startTriggeredMeasurement(); ++nTries)
+        {
+        if (sdp.getLastError() != cSDP::Error::WakeupPending || nTries >= kMaxTries)
+            {
+            std::printf("pass %u: startTriggeredMeasurement failed %s\n", iPass, sdp.getLastErrorName());
+            return false;
+            }
+        clock.delay(1);
+        }
+
+    for (nTries = 0; ! sdp.queryReady(); ++nTries)
+        {
+        if (sdp.getLastError() != cSDP::Error::Busy || nTries >= kMaxTries)
+            {
+            std::printf("pass %u: queryReady failed %s\n", iPass, sdp.getLastErrorName());
+            return false;
+            }
+        clock.delay(1);
+        }
+
+    if (! sdp.readMeasurement())
+        {
+        std::printf("pass %u: readMeasurement failed %s\n", iPass, sdp.getLastErrorName());
+        return false;
+        }
+
+    if (! sdp.sleep())
+        {
+        std::printf("pass %u: sleep failed %s\n", iPass, sdp.getLastErrorName());
+        return false;
+        }
+
+    const auto m = sdp.getMeasurement();
+
+    std::printf("pass %u: T=%.2f C  DP=%.2f Pa\n", iPass, m.Temperature, m.DifferentialPressure);
+    clock.delay(1000);
+    return true;
+    }
+
+static bool runProduct(const char *pName, const cSimSdp::Config &config)
+    {
+    cSimClock clock;
+    cSimBus bus { clock };
+    cSimSdp device { config };
+    cSDP sdp { bus, clock, cSDP::Address(config.Address) };
+
+    bus.attach(device);
+    device.setValues(42.5f, 23.0f);
+
+    std::printf("%s\n", pName);
+    if (! sdp.begin())
+        {
+        std::printf("begin failed %s\n", sdp.getLastErrorName());
+        return false;
+        }
+
+    // the second pass is the first one after sleep().
+    for (unsigned iPass = 0; iPass < 2; ++iPass)
+        {
+        if (! loopOnce(clock, sdp, iPass))
+            return false;
+        }
+
+    return true;
+    }
+
+int main()
+    {
+    bool fResult = true;
+
+    fResult &= runProduct("SDP31", cSimSdp::configSDP31());
+    fResult &= runProduct("SDP810-125Pa", cSimSdp::configSDP810_125());
+
+    std::printf("%s\n", fResult ? "PASS" : "FAIL");
+    return fResult ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
@@ -0,0 +1,385 @@
+/*
+
+Module: sdp_host_sim.cpp
+
+Function:
+    Implementation of the host-side SDP simulation.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include "sdp_host_sim.h"
+
+#include <cmath>
+
+using namespace SdpHostSim;
+using McciCatenaSdp::cSDP;
+
+/****************************************************************************\
+|
+|   The simulated device
+|
+\****************************************************************************/
+
+cSimSdp::Config cSimSdp::configSDP31()
+    {
+    Config c;
+
+    c.Address = std::uint8_t(cSDP::Address::SDP3x_A);
+    c.ProductNumber = std::uint32_t(cSDP::ProductId_t::SDP31);
+    c.SerialNumber = 0x0000000100000031ull;
+    c.Scale = 60;
+    c.ConversionUs = 38000;
+    c.ConversionJitterUs = 2000;
+    c.WakeUs = 1000;
+    return c;
+    }
+
+cSimSdp::Config cSimSdp::configSDP810_125()
+    {
+    Config c;
+
+    c.Address = std::uint8_t(cSDP::Address::SDP8xx);
+    c.ProductNumber = std::uint32_t(cSDP::ProductId_t::SDP810_125);
+    c.SerialNumber = 0x0000000200000810ull;
+    c.Scale = 240;
+    c.ConversionUs = 40000;
+    c.ConversionJitterUs = 3000;
+    c.WakeUs = 1000;
+    return c;
+    }
+
+std::uint8_t cSimSdp::crc8(const std::uint8_t *pBuf, std::size_t nBuf)
+    {
+    std::uint8_t crc = 0xFF;
+
+    for (; nBuf > 0; --nBuf, ++pBuf)
+        {
+        crc ^= *pBuf;
+        for (unsigned iBit = 0; iBit < 8; ++iBit)
+            crc = (crc & 0x80) ? std::uint8_t((crc << 1) ^ 0x31) : std::uint8_t(crc << 1);
+        }
+
+    return crc;
+    }
+
+// a small LCG; good enough for noise and fault injection.
+std::uint32_t cSimSdp::random()
+    {
+    this->m_random = this->m_random * 1664525u + 1013904223u;
+    return this->m_random;
+    }
+
+bool cSimSdp::chance(std::uint32_t ppm)
+    {
+    if (ppm == 0)
+        return false;
+    return (this->random() >> 8) % 1000000u < ppm;
+    }
+
+// handle the wake protocol. Returns true if the device is awake and can
+// respond; false if it NACKs.
+bool cSimSdp::checkAwake(std::uint64_t tNowUs)
+    {
+    if (this->m_state == State::Sleep)
+        {
+        if (this->m_faults.WakeFailures > 0)
+            {
+            --this->m_faults.WakeFailures;
+            return false;
+            }
+
+        // the address wakes the device, but it NACKs until it's ready.
+        this->m_state = State::Waking;
+        this->m_tWakeUs = tNowUs + this->m_config.WakeUs;
+        return false;
+        }
+
+    if (this->m_state == State::Waking)
+        {
+        if (tNowUs < this->m_tWakeUs)
+            return false;
+        this->m_state = State::Idle;
+        }
+
+    return true;
+    }
+
+bool cSimSdp::onWrite(const std::uint8_t *pBuf, std::size_t nBuf, std::uint64_t tNowUs)
+    {
+    if (! this->checkAwake(tNowUs))
+        return this->nack();
+
+    // address-only write: just an ACK.
+    if (nBuf == 0)
+        return true;
+
+    if (nBuf != 2)
+        return this->nack();
+
+    const auto command = cSDP::Command((pBuf[0] << 8) | pBuf[1]);
+    ++this->m_nCommands;
+
+    // while converting, only stop is accepted.
+    if (this->m_state == State::Continuous)
+        {
+        if (command != cSDP::Command::StopContinuousMeasurement)
+            return this->nack();
+        this->m_state = State::Idle;
+        this->m_tStopDoneUs = tNowUs + kStopSettleUs;
+        return true;
+        }
+
+    if (this->m_state != State::Idle || tNowUs < this->m_tStopDoneUs)
+        return this->nack();
+
+    // the second half of the product ID sequence must follow the first.
+    if (this->m_fIdPending && command != cSDP::Command::ReadProductId2)
+        this->m_fIdPending = false;
+
+    const std::uint32_t tConversionUs =
+        this->m_config.ConversionUs - this->m_config.ConversionJitterUs +
+        (this->m_config.ConversionJitterUs == 0 ? 0 : this->random() % (2 * this->m_config.ConversionJitterUs + 1));
+
+    this->m_fIdSelected = false;
+
+    switch (command)
+        {
+    case cSDP::Command::StartTriggeredDifferential_Poll:
+    case cSDP::Command::StartTriggeredMassflow_Poll:
+        this->m_state = State::Triggered;
+        this->m_tReadyUs = tNowUs + tConversionUs;
+        ++this->m_nConversions;
+        break;
+
+    case cSDP::Command::StartTriggeredDifferential_Stretch:
+    case cSDP::Command::StartTriggeredMassflow_Stretch:
+        this->m_state = State::TriggeredStretch;
+        this->m_tReadyUs = tNowUs + tConversionUs;
+        ++this->m_nConversions;
+        break;
+
+    case cSDP::Command::StartContinuousDifferential_Average:
+    case cSDP::Command::StartContinuousDifferential_Point:
+    case cSDP::Command::StartContinuousMassFlow_Average:
+    case cSDP::Command::StartContinuousMassFlow_Point:
+        this->m_state = State::Continuous;
+        this->m_tReadyUs = tNowUs + 8000;
+        break;
+
+    case cSDP::Command::EnterSleepMode:
+        this->m_state = State::Sleep;
+        break;
+
+    case cSDP::Command::ReadProductId1:
+        this->m_fIdPending = true;
+        break;
+
+    case cSDP::Command::ReadProductId2:
+        if (! this->m_fIdPending)
+            return this->nack();
+        this->m_fIdPending = false;
+        this->m_fIdSelected = true;
+        break;
+
+    default:
+        return this->nack();
+        }
+
+    return true;
+    }
+
+bool cSimSdp::onRead(std::uint8_t *pBuf, std::size_t nBuf, std::uint64_t tNowUs, std::uint64_t *pStretchUs)
+    {
+    *pStretchUs = 0;
+
+    if (! this->checkAwake(tNowUs))
+        return this->nack();
+
+    if (this->chance(this->m_faults.ReadNackPpm))
+        return this->nack();
+
+    std::size_t nFilled;
+
+    switch (this->m_state)
+        {
+    case State::Triggered:
+        if (tNowUs < this->m_tReadyUs)
+            return this->nack();
+        nFilled = this->fillMeasurement(pBuf, nBuf);
+        this->m_state = State::Idle;
+        break;
+
+    case State::TriggeredStretch:
+        // hold the clock until the conversion completes.
+        if (tNowUs < this->m_tReadyUs)
+            *pStretchUs = this->m_tReadyUs - tNowUs;
+        nFilled = this->fillMeasurement(pBuf, nBuf);
+        this->m_state = State::Idle;
+        break;
+
+    case State::Continuous:
+        if (tNowUs < this->m_tReadyUs)
+            return this->nack();
+        nFilled = this->fillMeasurement(pBuf, nBuf);
+        break;
+
+    case State::Idle:
+        if (! this->m_fIdSelected)
+            return this->nack();
+        nFilled = this->fillProductId(pBuf, nBuf);
+        break;
+
+    default:
+        return this->nack();
+        }
+
+    if (nFilled != nBuf)
+        return this->nack();
+
+    // corrupt a CRC if asked.
+    if (nBuf >= 3 && this->chance(this->m_faults.CrcErrorPpm))
+        pBuf[2] ^= 0x01;
+
+    return true;
+    }
+
+void cSimSdp::putWord(std::uint8_t *pWord, std::uint16_t v)
+    {
+    pWord[0] = std::uint8_t(v >> 8);
+    pWord[1] = std::uint8_t(v);
+    pWord[2] = crc8(pWord, 2);
+    }
+
+std::size_t cSimSdp::fillMeasurement(std::uint8_t *pBuf, std::size_t nBuf)
+    {
+    if (nBuf > 9 || nBuf % 3 != 0)
+        return 0;
+
+    float dp = this->m_diffPressurePa;
+    if (this->m_noisePa != 0.0f)
+        dp += this->m_noisePa * (float(this->random() >> 8) / float(1u << 24) - 0.5f);
+
+    float dpBits = std::round(dp * this->m_config.Scale);
+    if (dpBits > 32767.0f)
+        dpBits = 32767.0f;
+    else if (dpBits < -32768.0f)
+        dpBits = -32768.0f;
+
+    const std::uint16_t words[3] =
+        {
+        std::uint16_t(std::int16_t(dpBits)),
+        std::uint16_t(std::int16_t(std::round(this->m_temperatureC * 200.0f))),
+        this->m_config.Scale,
+        };
+
+    for (std::size_t i = 0; i < nBuf / 3; ++i)
+        this->putWord(pBuf + 3 * i, words[i]);
+
+    return nBuf;
+    }
+
+std::size_t cSimSdp::fillProductId(std::uint8_t *pBuf, std::size_t nBuf)
+    {
+    if (nBuf > 18 || nBuf % 3 != 0)
+        return 0;
+
+    const std::uint32_t pn = this->m_config.ProductNumber;
+    const std::uint64_t sn = this->m_config.SerialNumber;
+    const std::uint16_t words[6] =
+        {
+        std::uint16_t(pn >> 16), std::uint16_t(pn),
+        std::uint16_t(sn >> 48), std::uint16_t(sn >> 32),
+        std::uint16_t(sn >> 16), std::uint16_t(sn),
+        };
+
+    for (std::size_t i = 0; i < nBuf / 3; ++i)
+        this->putWord(pBuf + 3 * i, words[i]);
+
+    return nBuf;
+    }
+
+/****************************************************************************\
+|
+|   The simulated bus
+|
+\****************************************************************************/
+
+bool cSimBus::attach(cSimSdp &device)
+    {
+    if (this->m_nDevices >= kMaxDevices || this->findDevice(device.getAddress()) != nullptr)
+        return false;
+
+    this->m_pDevice[this->m_nDevices++] = &device;
+    return true;
+    }
+
+cSimSdp *cSimBus::findDevice(std::uint8_t addr)
+    {
+    for (unsigned i = 0; i < this->m_nDevices; ++i)
+        {
+        if (this->m_pDevice[i]->getAddress() == addr)
+            return this->m_pDevice[i];
+        }
+
+    return nullptr;
+    }
+
+// account for the time taken by nBytes on the wire (9 clocks per byte,
+// plus start and stop).
+void cSimBus::spendBytes(std::size_t nBytes)
+    {
+    const std::uint64_t us = ((nBytes * 9 + 2) * 1000000ull + this->m_busHz - 1) / this->m_busHz;
+
+    this->m_stats.BusTimeUs += us;
+    this->m_pClock->advanceUs(us);
+    }
+
+cSimBus::Status cSimBus::write(std::uint8_t addr, const std::uint8_t *pBuf, std::size_t nBuf)
+    {
+    cSimSdp * const pDevice = this->findDevice(addr);
+
+    ++this->m_stats.Transactions;
+    if (pDevice == nullptr || ! pDevice->onWrite(pBuf, nBuf, this->m_pClock->getMicros()))
+        {
+        // the address byte goes out, and is NACKed.
+        this->spendBytes(1);
+        ++this->m_stats.Nacks;
+        return Status::WriteNack;
+        }
+
+    this->spendBytes(1 + nBuf);
+    this->m_stats.BytesWritten += nBuf;
+    return Status::Success;
+    }
+
+cSimBus::Status cSimBus::read(std::uint8_t addr, std::uint8_t *pBuf, std::size_t nBuf)
+    {
+    cSimSdp * const pDevice = this->findDevice(addr);
+    std::uint64_t stretchUs;
+
+    ++this->m_stats.Transactions;
+    if (pDevice == nullptr || ! pDevice->onRead(pBuf, nBuf, this->m_pClock->getMicros(), &stretchUs))
+        {
+        this->spendBytes(1);
+        ++this->m_stats.Nacks;
+        return Status::ReadRequest;
+        }
+
+    this->m_stats.BusTimeUs += stretchUs;
+    this->m_pClock->advanceUs(stretchUs);
+    this->spendBytes(1 + nBuf);
+    this->m_stats.BytesRead += nBuf;
+    return Status::Success;
+    }
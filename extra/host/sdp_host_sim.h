@@ -0,0 +1,232 @@
+/*
+
+Module: sdp_host_sim.h
+
+Function:
+    Host-side simulation of SDP sensors and the I2C bus, for running and
+    profiling the Catena SDP library on a Linux (or other) host.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _sdp_host_sim_h_
+#define _sdp_host_sim_h_ /* prevent multiple includes */
+
+#pragma once
+
+#include <MCCI_Catena_SDP.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SdpHostSim {
+
+/****************************************************************************\
+|
+|   The simulated clock. Time only moves when the bus is used, when the
+|   driver calls delay(), or when the application calls advanceUs().
+|
+\****************************************************************************/
+
+class cSimClock : public McciCatenaSdp::cClock
+    {
+public:
+    virtual std::uint32_t millis() override
+        {
+        return std::uint32_t(this->m_us / 1000);
+        }
+    virtual void delay(std::uint32_t ms) override
+        {
+        this->m_us += std::uint64_t(ms) * 1000;
+        }
+    void advanceUs(std::uint64_t us)
+        {
+        this->m_us += us;
+        }
+    std::uint64_t getMicros() const
+        {
+        return this->m_us;
+        }
+
+private:
+    std::uint64_t m_us = 0;
+    };
+
+/****************************************************************************\
+|
+|   A simulated SDP3x or SDP8xx, emulated at the level of bus transfers.
+|
+\****************************************************************************/
+
+class cSimSdp
+    {
+public:
+    struct Config
+        {
+        std::uint8_t    Address;
+        std::uint32_t   ProductNumber;
+        std::uint64_t   SerialNumber;
+        std::uint16_t   Scale;              // DP scale factor, counts per Pa
+        std::uint32_t   ConversionUs;       // typical triggered conversion time
+        std::uint32_t   ConversionJitterUs; // +/- random variation of ConversionUs
+        std::uint32_t   WakeUs;             // time from wake request to ACK
+        };
+
+    // fault injection settings; rates are in parts per million.
+    struct Faults
+        {
+        std::uint32_t   CrcErrorPpm;        // corrupt a CRC in a read
+        std::uint32_t   ReadNackPpm;        // NACK a read that should succeed
+        std::uint32_t   WakeFailures;       // number of wake requests to ignore
+        };
+
+    // the sensor ignores commands for this long after a stop command.
+    static constexpr std::uint32_t kStopSettleUs = 500;
+
+    static Config configSDP31();
+    static Config configSDP810_125();
+
+    cSimSdp(const Config &config)
+        : m_config(config)
+        {}
+
+    // set the simulated physical values.
+    void setValues(float diffPressurePa, float temperatureC)
+        {
+        this->m_diffPressurePa = diffPressurePa;
+        this->m_temperatureC = temperatureC;
+        }
+    // set peak-to-peak uniform noise on the DP reading, in Pa.
+    void setNoise(float noisePa)
+        {
+        this->m_noisePa = noisePa;
+        }
+    void setFaults(const Faults &faults)
+        {
+        this->m_faults = faults;
+        }
+    // power-cycle the device: it comes up awake and idle.
+    void powerOn()
+        {
+        this->m_state = State::Idle;
+        this->m_fIdSelected = false;
+        }
+
+    std::uint8_t getAddress() const
+        {
+        return this->m_config.Address;
+        }
+
+    // bus interface: return true for ACK. tNowUs is the time of the
+    // transfer; for reads, *pStretchUs is set to the clock-stretch time.
+    bool onWrite(const std::uint8_t *pBuf, std::size_t nBuf, std::uint64_t tNowUs);
+    bool onRead(std::uint8_t *pBuf, std::size_t nBuf, std::uint64_t tNowUs, std::uint64_t *pStretchUs);
+
+    // statistics
+    std::uint32_t getCommandCount() const { return this->m_nCommands; }
+    std::uint32_t getNackCount() const { return this->m_nNacks; }
+    std::uint32_t getConversionCount() const { return this->m_nConversions; }
+
+    // the Sensirion CRC, computed bitwise as a cross-check on the driver.
+    static std::uint8_t crc8(const std::uint8_t *pBuf, std::size_t nBuf);
+
+private:
+    enum class State : std::uint8_t
+        {
+        Sleep,
+        Waking,
+        Idle,
+        Triggered,
+        TriggeredStretch,
+        Continuous,
+        };
+
+    bool nack()
+        {
+        ++this->m_nNacks;
+        return false;
+        }
+    bool checkAwake(std::uint64_t tNowUs);
+    bool chance(std::uint32_t ppm);
+    std::uint32_t random();
+    void putWord(std::uint8_t *pWord, std::uint16_t v);
+    std::size_t fillMeasurement(std::uint8_t *pBuf, std::size_t nBuf);
+    std::size_t fillProductId(std::uint8_t *pBuf, std::size_t nBuf);
+
+    Config m_config;
+    Faults m_faults {};
+    State m_state = State::Idle;
+    bool m_fIdSelected = false;     // product ID command sequence complete
+    bool m_fIdPending = false;      // first half of product ID command seen
+    std::uint64_t m_tReadyUs = 0;   // when the current conversion completes
+    std::uint64_t m_tWakeUs = 0;    // when a waking device will ACK
+    std::uint64_t m_tStopDoneUs = 0; // when commands are accepted after a stop
+    float m_diffPressurePa = 0.0f;
+    float m_temperatureC = 25.0f;
+    float m_noisePa = 0.0f;
+    std::uint32_t m_random = 0x12345678u;
+    std::uint32_t m_nCommands = 0;
+    std::uint32_t m_nNacks = 0;
+    std::uint32_t m_nConversions = 0;
+    };
+
+/****************************************************************************\
+|
+|   The simulated bus. Each transfer advances the clock by the time the
+|   bytes would take on the wire at the configured rate.
+|
+\****************************************************************************/
+
+class cSimBus : public McciCatenaSdp::cBus
+    {
+public:
+    static constexpr unsigned kMaxDevices = 4;
+
+    cSimBus(cSimClock &clock, std::uint32_t busHz = 100000)
+        : m_pClock(&clock)
+        , m_busHz(busHz)
+        {}
+
+    bool attach(cSimSdp &device);
+
+    virtual void begin() override {}
+    virtual Status write(std::uint8_t addr, const std::uint8_t *pBuf, std::size_t nBuf) override;
+    virtual Status read(std::uint8_t addr, std::uint8_t *pBuf, std::size_t nBuf) override;
+
+    // statistics
+    struct Stats
+        {
+        std::uint32_t   Transactions;
+        std::uint32_t   Nacks;
+        std::uint32_t   BytesWritten;
+        std::uint32_t   BytesRead;
+        std::uint64_t   BusTimeUs;
+        };
+    const Stats &getStats() const { return this->m_stats; }
+    void resetStats() { this->m_stats = Stats {}; }
+
+private:
+    cSimSdp *findDevice(std::uint8_t addr);
+    void spendBytes(std::size_t nBytes);
+
+    cSimClock *m_pClock;
+    std::uint32_t m_busHz;
+    cSimSdp *m_pDevice[kMaxDevices] {};
+    unsigned m_nDevices = 0;
+    Stats m_stats {};
+    };
+
+} // namespace SdpHostSim
+
+#endif /* _sdp_host_sim_h_ */
@@ -3,7 +3,7 @@
 Name:   message-port1-format-1f-decoder-ttn.js
 
 Function:
-    Decode port 0x01 format 0x1f messages for TTN console.
+    Decode port 0x01 format 0x1f, 0x21 and 0x22 messages for TTN console.
 
 Copyright and License:
     See accompanying LICENSE file at https://github.com/mcci-catena/MCCI-Catena-PMS7003/
@@ -58,6 +58,89 @@ function DecodeDiffPressure(Parse) {
     return DecodeSflt16(Parse) * 32768.0 / 60.0;
 }
 
+function DecodeDiffPressureStdDev(Parse) {
+    return DecodeUflt16(Parse) * 32768.0 / 60.0;
+}
+
+function DecodeDiffPressureStats(Parse) {
+    var bytes = Parse.bytes;
+    var stats = {};
+
+    stats.Count = bytes[Parse.i++];
+    stats.Mean = DecodeDiffPressure(Parse);
+    stats.Min = DecodeDiffPressure(Parse);
+    stats.Max = DecodeDiffPressure(Parse);
+    stats.StdDev = DecodeDiffPressureStdDev(Parse);
+
+    return stats;
+}
+
+function DecodeDiffPressureQuantiles(Parse) {
+    var bytes = Parse.bytes;
+    var quantiles = [];
+
+    // each quantile is sent as the percentile in units of 0.5%,
+    // followed by the estimate.
+    for (var iQuantile = 0; iQuantile < 2; ++iQuantile) {
+        var q = {};
+
+        q.Percentile = bytes[Parse.i++] / 2;
+        q.DifferentialPressure = DecodeDiffPressure(Parse);
+        quantiles.push(q);
+    }
+
+    return quantiles;
+}
+
+function DecodeUvarint(Parse) {
+    var bytes = Parse.bytes;
+    var v = 0;
+    var scale = 1;
+    var b;
+
+    // seven bits per byte, least significant first; bit 7 is set in
+    // all but the last byte.
+    do {
+        b = bytes[Parse.i++];
+        v += (b & 0x7F) * scale;
+        scale *= 128;
+    } while (b & 0x80);
+
+    return v;
+}
+
+function DecodeZigzag(Parse) {
+    var u = DecodeUvarint(Parse);
+
+    // 0, 1, 2, 3, ... stand for 0, -1, 1, -2, ...
+    return (u % 2) ? -(u + 1) / 2 : u / 2;
+}
+
+function DecodeDiffPressureSeries(Parse) {
+    var bytes = Parse.bytes;
+    var series = {};
+    var n = bytes[Parse.i++];
+
+    series.ResolutionPa = bytes[Parse.i++] / 100;
+    series.IntervalSeconds = DecodeUvarint(Parse);
+    series.AgeSeconds = DecodeUvarint(Parse);
+
+    // the samples, oldest first: the first in units of the resolution,
+    // then the differences.
+    series.Samples = [];
+    var v = 0;
+    for (var iSample = 0; iSample < n; ++iSample) {
+        var sample = {};
+
+        v += DecodeZigzag(Parse);
+        sample.AgeSeconds = series.AgeSeconds + (n - 1 - iSample) * series.IntervalSeconds;
+        sample.DifferentialPressure = Math.round(v * series.ResolutionPa * 1000) / 1000;
+        series.Samples.push(sample);
+    }
+
+    return series;
+}
+
 function DecodeI16(Parse) {
     var i = Parse.i;
     var bytes = Parse.bytes;
@@ -71,10 +154,40 @@ function DecodeI16(Parse) {
     return Vraw;
 }
 
+function DecodeI32(Parse) {
+    var i = Parse.i;
+    var bytes = Parse.bytes;
+    // (x << 24) is a signed 32-bit result in JavaScript.
+    var Vraw = (bytes[i] << 24) + (bytes[i + 1] << 16) + (bytes[i + 2] << 8) + bytes[i + 3];
+    Parse.i = i + 4;
+    return Vraw;
+}
+
 function DecodeV(Parse) {
     return DecodeI16(Parse) / 4096.0;
 }
 
+function DecodeDiagnostics(Parse) {
+    var bytes = Parse.bytes;
+    var diag = {};
+
+    diag.Transactions = DecodeU16(Parse);
+    diag.Nacks = bytes[Parse.i++];
+    diag.ShortReads = bytes[Parse.i++];
+    diag.LongReads = bytes[Parse.i++];
+    diag.CrcErrors = bytes[Parse.i++];
+    diag.WakeRetries = bytes[Parse.i++];
+    diag.BusyPolls = DecodeU16(Parse);
+
+    // trigger-to-data latency: bin 0 is < 34 ms, bins are 4 ms wide,
+    // and bin 7 is >= 58 ms.
+    diag.LatencyHistogram = [];
+    for (var iBin = 0; iBin < 8; ++iBin)
+        diag.LatencyHistogram.push(bytes[Parse.i++]);
+
+    return diag;
+}
+
 function Decoder(bytes, port) {
     // Decode an uplink message from a buffer
     // (array) of bytes to an object of fields.
@@ -84,7 +197,7 @@ function Decoder(bytes, port) {
         return null;
 
     var uFormat = bytes[0];
-    if (! (uFormat === 0x1F))
+    if (! (uFormat === 0x1F || uFormat === 0x21 || uFormat === 0x22))
         return null;
 
     // an object to help us parse.
@@ -115,8 +228,39 @@ function Decoder(bytes, port) {
     }
 
     if (flags & 0x10) {
-        // we have differential pressure
-        decoded.DifferentialPressure = DecodeDiffPressure(Parse);
+        // we have differential pressure; format 0x21 sends statistics
+        // for the uplink interval, format 0x22 a series of readings, and
+        // format 0x1F a single reading.
+        if (uFormat === 0x22) {
+            var series = DecodeDiffPressureSeries(Parse);
+
+            if (series.Samples.length > 0)
+                decoded.DifferentialPressure = series.Samples[series.Samples.length - 1].DifferentialPressure;
+            decoded.DifferentialPressureSeries = series;
+        } else if (uFormat === 0x21) {
+            var dp = DecodeDiffPressureStats(Parse);
+
+            decoded.DifferentialPressure = dp.Mean;
+            decoded.DifferentialPressureStats = dp;
+        } else {
+            decoded.DifferentialPressure = DecodeDiffPressure(Parse);
+        }
+    }
+
+    if (flags & 0x20) {
+        // we have driver diagnostics
+        decoded.Diagnostics = DecodeDiagnostics(Parse);
+    }
+
+    if (uFormat === 0x21 && (flags & 0x40)) {
+        // we have differential pressure quantiles
+        decoded.DifferentialPressureQuantiles = DecodeDiffPressureQuantiles(Parse);
+    }
+
+    if (uFormat === 0x21 && (flags & 0x80)) {
+        // we have flow: volume in mL/s, mass in mg/s
+        decoded.FlowLitersPerSecond = DecodeI32(Parse) / 1000;
+        decoded.MassFlowGramsPerSecond = DecodeI32(Parse) / 1000;
     }
 
     return decoded;
@@ -35,6 +35,18 @@ struct val
     T v;
     };
 
+struct Diagnostics
+    {
+    std::uint32_t Transactions;
+    std::uint32_t Nacks;
+    std::uint32_t ShortReads;
+    std::uint32_t LongReads;
+    std::uint32_t CrcErrors;
+    std::uint32_t WakeRetries;
+    std::uint32_t BusyPolls;
+    std::uint32_t LatencyHist[8];
+    };
+
 struct Measurements
     {
     val<float> Vbat;
@@ -43,6 +55,7 @@ struct Measurements
     val<std::uint8_t> Boot;
     val<float> Temperature;
     val<float> DifferentialPressure;
+    val<Diagnostics> Diag;
     };
 
 uint16_t
@@ -168,6 +181,16 @@ std::uint16_t encode16u(float v)
         }
     }
 
+std::uint8_t sat8(std::uint32_t v)
+    {
+    return v > 0xFFu ? 0xFFu : std::uint8_t(v);
+    }
+
+std::uint16_t sat16(std::uint32_t v)
+    {
+    return v > 0xFFFFu ? 0xFFFFu : std::uint16_t(v);
+    }
+
 std::uint16_t encodeV(float v)
     {
     return encode16s(v * 4096.0f);
@@ -237,6 +260,23 @@ void encodeMeasurement(Buffer &buf, Measurements &m)
         buf.push_back_be(encodeDiffP(m.DifferentialPressure.v));
         }
 
+    if (m.Diag.fValid)
+        {
+        const Diagnostics &d = m.Diag.v;
+
+        flags |= 1 << 5;
+
+        buf.push_back_be(sat16(d.Transactions));
+        buf.push_back(sat8(d.Nacks));
+        buf.push_back(sat8(d.ShortReads));
+        buf.push_back(sat8(d.LongReads));
+        buf.push_back(sat8(d.CrcErrors));
+        buf.push_back(sat8(d.WakeRetries));
+        buf.push_back_be(sat16(d.BusyPolls));
+        for (auto v : d.LatencyHist)
+            buf.push_back(sat8(v));
+        }
+
     // update the flags
     buf.data()[1] = flags;
     }
@@ -290,6 +330,22 @@ void logMeasurement(Measurements &m)
         std::cout << pad.get() << "deltaP " << m.DifferentialPressure.v;
         }
 
+    if (m.Diag.fValid)
+        {
+        const Diagnostics &d = m.Diag.v;
+
+        std::cout << pad.get() << "Diag"
+                  << " " << d.Transactions
+                  << " " << d.Nacks
+                  << " " << d.ShortReads
+                  << " " << d.LongReads
+                  << " " << d.CrcErrors
+                  << " " << d.WakeRetries
+                  << " " << d.BusyPolls;
+        for (auto v : d.LatencyHist)
+            std::cout << " " << v;
+        }
+
     // make the syntax cut/pastable.
     std::cout << pad.get() << ".\n";
     }
@@ -357,6 +413,16 @@ int main(int argc, char **argv)
             std::cin >> m.DifferentialPressure.v;
             m.DifferentialPressure.fValid = true;
             }
+        else if (key == "Diag")
+            {
+            Diagnostics &d = m.Diag.v;
+
+            std::cin >> d.Transactions >> d.Nacks >> d.ShortReads >> d.LongReads
+                     >> d.CrcErrors >> d.WakeRetries >> d.BusyPolls;
+            for (auto &v : d.LatencyHist)
+                std::cin >> v;
+            m.Diag.fValid = true;
+            }
         else if (key == ".")
             {
             putTestVector(m);
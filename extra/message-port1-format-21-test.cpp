@@ -0,0 +1,552 @@
+/*
+
+Module:	message-port1-format-21-test.cpp
+
+Function:
+	Test vector generator for port 1, format 0x21
+
+Copyright and License:
+	This file copyright (C) 2020 by
+
+		MCCI Corporation
+		3520 Krums Corners Road
+		Ithaca, NY  14850
+
+	See accompanying LICENSE file for copyright and license information.
+
+Author:
+	Terry Moore, MCCI Corporation	September 2020
+
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+std::string key;
+std::string value;
+
+template <typename T>
+struct val
+    {
+    bool fValid;
+    T v;
+    };
+
+struct Diagnostics
+    {
+    std::uint32_t Transactions;
+    std::uint32_t Nacks;
+    std::uint32_t ShortReads;
+    std::uint32_t LongReads;
+    std::uint32_t CrcErrors;
+    std::uint32_t WakeRetries;
+    std::uint32_t BusyPolls;
+    std::uint32_t LatencyHist[8];
+    };
+
+struct DpStats
+    {
+    std::uint32_t n;
+    float Mean;
+    float Min;
+    float Max;
+    float StdDev;
+    };
+
+struct Quantile
+    {
+    float Percent;
+    float Value;
+    };
+
+struct Quantiles
+    {
+    Quantile q[2];
+    };
+
+struct FlowRates
+    {
+    std::int32_t VolumeMilliLPerS;
+    std::int32_t MassMgPerS;
+    };
+
+struct Measurements
+    {
+    val<float> Vbat;
+    val<float> Vsys;
+    val<float> Vbus;
+    val<std::uint8_t> Boot;
+    val<float> Temperature;
+    val<DpStats> DifferentialPressure;
+    val<Diagnostics> Diag;
+    val<Quantiles> Quant;
+    val<FlowRates> Flow;
+    };
+
+uint16_t
+LMIC_f2uflt16(
+        float f
+        )
+        {
+        if (f < 0.0)
+                return 0;
+        else if (f >= 1.0)
+                return 0xFFFF;
+        else
+                {
+                int iExp;
+                float normalValue;
+
+                normalValue = std::frexp(f, &iExp);
+
+                // f is supposed to be in [0..1), so useful exp
+                // is [0..-15]
+                iExp += 15;
+                if (iExp < 0)
+                        // underflow.
+                        iExp = 0;
+
+                // bits 15..12 are the exponent
+                // bits 11..0 are the fraction
+                // we conmpute the fraction and then decide if we need to round.
+                uint16_t outputFraction = std::ldexp(normalValue, 12) + 0.5;
+                if (outputFraction >= (1 << 12u))
+                        {
+                        // reduce output fraction
+                        outputFraction = 1 << 11;
+                        // increase exponent
+                        ++iExp;
+                        }
+
+                // check for overflow and return max instead.
+                if (iExp > 15)
+                        return 0xFFFF;
+
+                return (uint16_t)((iExp << 12u) | outputFraction);
+                }
+        }
+
+uint16_t
+LMIC_f2sflt16(
+        float f
+        )
+        {
+        if (f <= -1.0)
+                return 0xFFFF;
+        else if (f >= 1.0)
+                return 0x7FFF;
+        else
+                {
+                int iExp;
+                float normalValue;
+                uint16_t sign;
+
+                normalValue = frexpf(f, &iExp);
+
+                sign = 0;
+                if (normalValue < 0)
+                        {
+                        // set the "sign bit" of the result
+                        // and work with the absolute value of normalValue.
+                        sign = 0x8000;
+                        normalValue = -normalValue;
+                        }
+
+                // abs(f) is supposed to be in [0..1), so useful exp
+                // is [0..-15]
+                iExp += 15;
+                if (iExp < 0)
+                        iExp = 0;
+
+                // bit 15 is the sign
+                // bits 14..11 are the exponent
+                // bits 10..0 are the fraction
+                // we conmpute the fraction and then decide if we need to round.
+                uint16_t outputFraction = ldexpf(normalValue, 11) + 0.5;
+                if (outputFraction >= (1 << 11u))
+                        {
+                        // reduce output fraction
+                        outputFraction = 1 << 10;
+                        // increase exponent
+                        ++iExp;
+                        }
+
+                // check for overflow and return max instead.
+                if (iExp > 15)
+                        return 0x7FFF | sign;
+
+                return (uint16_t)(sign | (iExp << 11u) | outputFraction);
+                }
+        }
+
+std::uint16_t encode16s(float v)
+    {
+    float nv = std::floor(v + 0.5f);
+
+    if (nv > 32767.0f)
+        return 0x7FFFu;
+    else if (nv < -32768.0f)
+        return 0x8000u;
+    else
+        {
+        return (std::uint16_t) std::int16_t(nv);
+        }
+    }
+
+std::uint16_t encode16u(float v)
+    {
+    float nv = std::floor(v + 0.5f);
+    if (nv > 65535.0f)
+        return 0xFFFFu;
+    else if (nv < 0.0f)
+        return 0;
+    else
+        {
+        return std::uint16_t(nv);
+        }
+    }
+
+std::uint8_t sat8(std::uint32_t v)
+    {
+    return v > 0xFFu ? 0xFFu : std::uint8_t(v);
+    }
+
+std::uint16_t sat16(std::uint32_t v)
+    {
+    return v > 0xFFFFu ? 0xFFFFu : std::uint16_t(v);
+    }
+
+std::uint16_t encodeV(float v)
+    {
+    return encode16s(v * 4096.0f);
+    }
+
+std::uint16_t encodeT(float v)
+    {
+    return encode16s(v * 200.0f);
+    }
+
+std::uint16_t encodeDiffP(float v)
+    {
+    return encode16u(LMIC_f2sflt16(v * 60.0f / 32768.0f));
+    }
+
+std::uint16_t encodeDiffPStdDev(float v)
+    {
+    return encode16u(LMIC_f2uflt16(v * 60.0f / 32768.0f));
+    }
+
+class Buffer : public std::vector<std::uint8_t>
+    {
+public:
+    Buffer() : std::vector<std::uint8_t>() {};
+
+    void push_back_be(std::uint16_t v)
+        {
+        this->push_back(std::uint8_t(v >> 8));
+        this->push_back(std::uint8_t(v & 0xFF));
+        }
+    void push_back_be32(std::uint32_t v)
+        {
+        this->push_back_be(std::uint16_t(v >> 16));
+        this->push_back_be(std::uint16_t(v & 0xFFFF));
+        }
+    };
+
+void encodeMeasurement(Buffer &buf, Measurements &m)
+    {
+    std::uint8_t flags = 0;
+
+    // sent the type byte
+    buf.clear();
+    buf.push_back(0x21);
+    buf.push_back(0u); // flag byte.
+
+    // put the fields
+    if (m.Vbat.fValid)
+        {
+        flags |= 1 << 0;
+        buf.push_back_be(encodeV(m.Vbat.v));
+        }
+
+    if (m.Vsys.fValid)
+        {
+        flags |= 1 << 1;
+        buf.push_back_be(encodeV(m.Vsys.v));
+        }
+
+    if (m.Boot.fValid)
+        {
+        flags |= 1 << 2;
+        buf.push_back(m.Boot.v);
+        }
+
+    if (m.Temperature.fValid)
+        {
+        flags |= 1 << 3;
+
+        buf.push_back_be(encodeT(m.Temperature.v));
+        }
+
+    if (m.DifferentialPressure.fValid)
+        {
+        flags |= 1 << 4;
+
+        const DpStats &dp = m.DifferentialPressure.v;
+
+        buf.push_back(sat8(dp.n));
+        buf.push_back_be(encodeDiffP(dp.Mean));
+        buf.push_back_be(encodeDiffP(dp.Min));
+        buf.push_back_be(encodeDiffP(dp.Max));
+        buf.push_back_be(encodeDiffPStdDev(dp.StdDev));
+        }
+
+    if (m.Diag.fValid)
+        {
+        const Diagnostics &d = m.Diag.v;
+
+        flags |= 1 << 5;
+
+        buf.push_back_be(sat16(d.Transactions));
+        buf.push_back(sat8(d.Nacks));
+        buf.push_back(sat8(d.ShortReads));
+        buf.push_back(sat8(d.LongReads));
+        buf.push_back(sat8(d.CrcErrors));
+        buf.push_back(sat8(d.WakeRetries));
+        buf.push_back_be(sat16(d.BusyPolls));
+        for (auto v : d.LatencyHist)
+            buf.push_back(sat8(v));
+        }
+
+    if (m.Quant.fValid)
+        {
+        flags |= 1 << 6;
+
+        for (auto const &q : m.Quant.v.q)
+            {
+            buf.push_back(sat8(std::uint32_t(q.Percent * 2.0f + 0.5f)));
+            buf.push_back_be(encodeDiffP(q.Value));
+            }
+        }
+
+    if (m.Flow.fValid)
+        {
+        flags |= 1 << 7;
+
+        buf.push_back_be32(std::uint32_t(m.Flow.v.VolumeMilliLPerS));
+        buf.push_back_be32(std::uint32_t(m.Flow.v.MassMgPerS));
+        }
+
+    // update the flags
+    buf.data()[1] = flags;
+    }
+
+void logMeasurement(Measurements &m)
+    {
+    class Padder {
+    public:
+        Padder() : m_first(true) {}
+        const char *get() {
+            if (this->m_first)
+                {
+                this->m_first = false;
+                return "";
+                }
+            else
+                return " ";
+            }
+        const char *nl() {
+            return this->m_first ? "" : "\n";
+            }
+    private:
+        bool m_first;
+    } pad;
+
+    std::cout << std::dec;
+
+    // put the fields
+    if (m.Vbat.fValid)
+        {
+        std::cout << pad.get() << "Vbat " << m.Vbat.v;
+        }
+
+    if (m.Vsys.fValid)
+        {
+        std::cout << pad.get() << "Vsys " << m.Vsys.v;
+        }
+
+    if (m.Boot.fValid)
+        {
+        std::cout << pad.get() << "Boot " << unsigned(m.Boot.v);
+        }
+
+    if (m.Temperature.fValid)
+        {
+        std::cout << pad.get() << "T " << m.Temperature.v;
+        }
+
+    if (m.DifferentialPressure.fValid)
+        {
+        const DpStats &dp = m.DifferentialPressure.v;
+
+        std::cout << pad.get() << "deltaP "
+                  << dp.n << " " << dp.Mean << " " << dp.Min << " "
+                  << dp.Max << " " << dp.StdDev;
+        }
+
+    if (m.Diag.fValid)
+        {
+        const Diagnostics &d = m.Diag.v;
+
+        std::cout << pad.get() << "Diag"
+                  << " " << d.Transactions
+                  << " " << d.Nacks
+                  << " " << d.ShortReads
+                  << " " << d.LongReads
+                  << " " << d.CrcErrors
+                  << " " << d.WakeRetries
+                  << " " << d.BusyPolls;
+        for (auto v : d.LatencyHist)
+            std::cout << " " << v;
+        }
+
+    if (m.Quant.fValid)
+        {
+        std::cout << pad.get() << "Quant";
+        for (auto const &q : m.Quant.v.q)
+            std::cout << " " << q.Percent << " " << q.Value;
+        }
+
+    if (m.Flow.fValid)
+        {
+        std::cout << pad.get() << "Flow "
+                  << m.Flow.v.VolumeMilliLPerS << " " << m.Flow.v.MassMgPerS;
+        }
+
+    // make the syntax cut/pastable.
+    std::cout << pad.get() << ".\n";
+    }
+
+void putTestVector(Measurements &m)
+    {
+    Buffer buf {};
+    logMeasurement(m);
+    encodeMeasurement(buf, m);
+    bool fFirst;
+
+    fFirst = true;
+    for (auto v : buf)
+        {
+        if (! fFirst)
+            std::cout << " ";
+        fFirst = false;
+        std::cout.width(2);
+        std::cout.fill('0');
+        std::cout << std::hex << unsigned(v);
+        }
+    std::cout << "\n";
+    }
+
+int main(int argc, char **argv)
+    {
+    Measurements m {0};
+    Measurements m0 {0};
+    bool fAny;
+
+    std::cout << "Input a line with name/values pairs\n";
+
+    fAny = false;
+    while (std::cin.good())
+        {
+        bool fUpdate = true;
+        key.clear();
+
+        std::cin >> key;
+
+        if (key == "Vbat")
+            {
+            std::cin >> m.Vbat.v;
+            m.Vbat.fValid = true;
+            }
+        else if (key == "Vsys")
+            {
+            std::cin >> m.Vsys.v;
+            m.Vsys.fValid = true;
+            }
+        else if (key == "Boot")
+            {
+            std::uint32_t nonce;
+            std::cin >> nonce;
+            m.Boot.v = (std::uint8_t) nonce;
+            m.Boot.fValid = true;
+            }
+        else if (key == "T")
+            {
+            std::cin >> m.Temperature.v;
+            m.Temperature.fValid = true;
+            }
+        else if (key == "deltaP")
+            {
+            DpStats &dp = m.DifferentialPressure.v;
+
+            std::cin >> dp.n >> dp.Mean >> dp.Min >> dp.Max >> dp.StdDev;
+            m.DifferentialPressure.fValid = true;
+            }
+        else if (key == "Diag")
+            {
+            Diagnostics &d = m.Diag.v;
+
+            std::cin >> d.Transactions >> d.Nacks >> d.ShortReads >> d.LongReads
+                     >> d.CrcErrors >> d.WakeRetries >> d.BusyPolls;
+            for (auto &v : d.LatencyHist)
+                std::cin >> v;
+            m.Diag.fValid = true;
+            }
+        else if (key == "Quant")
+            {
+            for (auto &q : m.Quant.v.q)
+                std::cin >> q.Percent >> q.Value;
+            m.Quant.fValid = true;
+            }
+        else if (key == "Flow")
+            {
+            std::cin >> m.Flow.v.VolumeMilliLPerS >> m.Flow.v.MassMgPerS;
+            m.Flow.fValid = true;
+            }
+        else if (key == ".")
+            {
+            putTestVector(m);
+            m = m0;
+            fAny = false;
+            fUpdate = false;
+            }
+        else if (key == "")
+            /* ignore empty keys */
+            fUpdate = false;
+        else
+            {
+            std::cerr << "unknown key: " << key << "\n";
+            fUpdate = false;
+            }
+
+        fAny |= fUpdate;
+        }
+
+    if (!std::cin.eof() && std::cin.fail())
+        {
+        std::string nextword;
+
+        std::cin.clear(std::cin.goodbit);
+        std::cin >> nextword;
+        std::cerr << "parse error: " << nextword << "\n";
+        return 1;
+        }
+
+    if (fAny)
+        putTestVector(m);
+
+    return 0;
+    }
@@ -0,0 +1,558 @@
+/*
+
+Module:	message-port1-format-22-test.cpp
+
+Function:
+	Reference encoder/decoder and test vector generator for port 1,
+	format 0x22
+
+Copyright and License:
+	This file copyright (C) 2020 by
+
+		MCCI Corporation
+		3520 Krums Corners Road
+		Ithaca, NY  14850
+
+	See accompanying LICENSE file for copyright and license information.
+
+Author:
+	Terry Moore, MCCI Corporation	September 2020
+
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+std::string key;
+std::string value;
+
+template <typename T>
+struct val
+    {
+    bool fValid;
+    T v;
+    };
+
+struct Diagnostics
+    {
+    std::uint32_t Transactions;
+    std::uint32_t Nacks;
+    std::uint32_t ShortReads;
+    std::uint32_t LongReads;
+    std::uint32_t CrcErrors;
+    std::uint32_t WakeRetries;
+    std::uint32_t BusyPolls;
+    std::uint32_t LatencyHist[8];
+    };
+
+struct DpSeries
+    {
+    std::uint32_t IntervalSec;      // seconds between samples
+    std::uint32_t AgeSec;           // age of the newest sample
+    std::uint32_t ResolutionMilliPa;    // a multiple of 10
+    std::vector<float> Samples;     // oldest first, in Pa
+    };
+
+struct Measurements
+    {
+    val<float> Vbat;
+    val<float> Vsys;
+    val<std::uint8_t> Boot;
+    val<float> Temperature;
+    val<DpSeries> Series;
+    val<Diagnostics> Diag;
+    };
+
+std::uint16_t encode16s(float v)
+    {
+    float nv = std::floor(v + 0.5f);
+
+    if (nv > 32767.0f)
+        return 0x7FFFu;
+    else if (nv < -32768.0f)
+        return 0x8000u;
+    else
+        {
+        return (std::uint16_t) std::int16_t(nv);
+        }
+    }
+
+std::uint8_t sat8(std::uint32_t v)
+    {
+    return v > 0xFFu ? 0xFFu : std::uint8_t(v);
+    }
+
+std::uint16_t sat16(std::uint32_t v)
+    {
+    return v > 0xFFFFu ? 0xFFFFu : std::uint16_t(v);
+    }
+
+std::uint16_t encodeV(float v)
+    {
+    return encode16s(v * 4096.0f);
+    }
+
+std::uint16_t encodeT(float v)
+    {
+    return encode16s(v * 200.0f);
+    }
+
+std::uint32_t zigzag(std::int32_t v)
+    {
+    return (std::uint32_t(v) << 1) ^ (v < 0 ? ~std::uint32_t(0) : 0);
+    }
+
+std::int32_t unzigzag(std::uint32_t u)
+    {
+    return std::int32_t(u >> 1) ^ -std::int32_t(u & 1);
+    }
+
+class Buffer : public std::vector<std::uint8_t>
+    {
+public:
+    Buffer() : std::vector<std::uint8_t>() {};
+
+    void push_back_be(std::uint16_t v)
+        {
+        this->push_back(std::uint8_t(v >> 8));
+        this->push_back(std::uint8_t(v & 0xFF));
+        }
+    void push_back_uvarint(std::uint32_t v)
+        {
+        while (v >= 0x80)
+            {
+            this->push_back(std::uint8_t(v | 0x80));
+            v >>= 7;
+            }
+        this->push_back(std::uint8_t(v));
+        }
+    };
+
+void encodeMeasurement(Buffer &buf, Measurements &m)
+    {
+    std::uint8_t flags = 0;
+
+    // sent the type byte
+    buf.clear();
+    buf.push_back(0x22);
+    buf.push_back(0u); // flag byte.
+
+    // put the fields
+    if (m.Vbat.fValid)
+        {
+        flags |= 1 << 0;
+        buf.push_back_be(encodeV(m.Vbat.v));
+        }
+
+    if (m.Vsys.fValid)
+        {
+        flags |= 1 << 1;
+        buf.push_back_be(encodeV(m.Vsys.v));
+        }
+
+    if (m.Boot.fValid)
+        {
+        flags |= 1 << 2;
+        buf.push_back(m.Boot.v);
+        }
+
+    if (m.Temperature.fValid)
+        {
+        flags |= 1 << 3;
+
+        buf.push_back_be(encodeT(m.Temperature.v));
+        }
+
+    if (m.Series.fValid)
+        {
+        flags |= 1 << 4;
+
+        const DpSeries &s = m.Series.v;
+        const std::int32_t resolution = s.ResolutionMilliPa;
+        std::int32_t previous = 0;
+
+        buf.push_back(sat8(s.Samples.size()));
+        buf.push_back(sat8(s.ResolutionMilliPa / 10));
+        buf.push_back_uvarint(s.IntervalSec);
+        buf.push_back_uvarint(s.AgeSec);
+
+        // the first sample, then the differences, in units of the
+        // resolution.
+        for (auto v : s.Samples)
+            {
+            const std::int32_t q = std::int32_t(std::floor(v * 1000.0f / resolution + 0.5f));
+
+            buf.push_back_uvarint(zigzag(q - previous));
+            previous = q;
+            }
+        }
+
+    if (m.Diag.fValid)
+        {
+        const Diagnostics &d = m.Diag.v;
+
+        flags |= 1 << 5;
+
+        buf.push_back_be(sat16(d.Transactions));
+        buf.push_back(sat8(d.Nacks));
+        buf.push_back(sat8(d.ShortReads));
+        buf.push_back(sat8(d.LongReads));
+        buf.push_back(sat8(d.CrcErrors));
+        buf.push_back(sat8(d.WakeRetries));
+        buf.push_back_be(sat16(d.BusyPolls));
+        for (auto v : d.LatencyHist)
+            buf.push_back(sat8(v));
+        }
+
+    // update the flags
+    buf.data()[1] = flags;
+    }
+
+// the reference decoder: the inverse of encodeMeasurement(). Returns false
+// if the message is not format 0x22, or is truncated.
+class Parser
+    {
+public:
+    Parser(const Buffer &buf) : m_buf(buf), m_i(0) {}
+
+    bool get(std::uint8_t &v)
+        {
+        if (this->m_i >= this->m_buf.size())
+            return false;
+        v = this->m_buf[this->m_i++];
+        return true;
+        }
+    bool get_be(std::uint16_t &v)
+        {
+        std::uint8_t hi, lo;
+
+        if (! (this->get(hi) && this->get(lo)))
+            return false;
+        v = std::uint16_t((hi << 8) | lo);
+        return true;
+        }
+    bool get_uvarint(std::uint32_t &v)
+        {
+        v = 0;
+        for (unsigned shift = 0; shift < 35; shift += 7)
+            {
+            std::uint8_t b;
+
+            if (! this->get(b))
+                return false;
+            v |= std::uint32_t(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+            }
+        return false;
+        }
+    bool isEnd() const
+        {
+        return this->m_i == this->m_buf.size();
+        }
+
+private:
+    const Buffer &m_buf;
+    std::size_t m_i;
+    };
+
+bool decodeMeasurement(const Buffer &buf, Measurements &m)
+    {
+    Parser p { buf };
+    std::uint8_t format, flags;
+    std::uint16_t v16;
+    std::uint8_t v8;
+
+    m = Measurements {};
+    if (! (p.get(format) && format == 0x22 && p.get(flags)))
+        return false;
+
+    if (flags & (1 << 0))
+        {
+        if (! p.get_be(v16))
+            return false;
+        m.Vbat.v = std::int16_t(v16) / 4096.0f;
+        m.Vbat.fValid = true;
+        }
+
+    if (flags & (1 << 1))
+        {
+        if (! p.get_be(v16))
+            return false;
+        m.Vsys.v = std::int16_t(v16) / 4096.0f;
+        m.Vsys.fValid = true;
+        }
+
+    if (flags & (1 << 2))
+        {
+        if (! p.get(m.Boot.v))
+            return false;
+        m.Boot.fValid = true;
+        }
+
+    if (flags & (1 << 3))
+        {
+        if (! p.get_be(v16))
+            return false;
+        m.Temperature.v = std::int16_t(v16) / 200.0f;
+        m.Temperature.fValid = true;
+        }
+
+    if (flags & (1 << 4))
+        {
+        DpSeries &s = m.Series.v;
+        std::uint8_t n;
+        std::int32_t previous = 0;
+
+        if (! (p.get(n) && p.get(v8) && p.get_uvarint(s.IntervalSec) && p.get_uvarint(s.AgeSec)))
+            return false;
+        s.ResolutionMilliPa = v8 * 10u;
+
+        for (unsigned i = 0; i < n; ++i)
+            {
+            std::uint32_t u;
+
+            if (! p.get_uvarint(u))
+                return false;
+            previous += unzigzag(u);
+            s.Samples.push_back(previous * float(s.ResolutionMilliPa) / 1000.0f);
+            }
+        m.Series.fValid = true;
+        }
+
+    if (flags & (1 << 5))
+        {
+        Diagnostics &d = m.Diag.v;
+
+        if (! p.get_be(v16)) return false;
+        d.Transactions = v16;
+        if (! p.get(v8)) return false;
+        d.Nacks = v8;
+        if (! p.get(v8)) return false;
+        d.ShortReads = v8;
+        if (! p.get(v8)) return false;
+        d.LongReads = v8;
+        if (! p.get(v8)) return false;
+        d.CrcErrors = v8;
+        if (! p.get(v8)) return false;
+        d.WakeRetries = v8;
+        if (! p.get_be(v16)) return false;
+        d.BusyPolls = v16;
+        for (auto &v : d.LatencyHist)
+            {
+            if (! p.get(v8)) return false;
+            v = v8;
+            }
+        m.Diag.fValid = true;
+        }
+
+    // bits 6 and 7 are reserved.
+    return (flags & 0xC0) == 0 && p.isEnd();
+    }
+
+void logMeasurement(Measurements &m)
+    {
+    class Padder {
+    public:
+        Padder() : m_first(true) {}
+        const char *get() {
+            if (this->m_first)
+                {
+                this->m_first = false;
+                return "";
+                }
+            else
+                return " ";
+            }
+        const char *nl() {
+            return this->m_first ? "" : "\n";
+            }
+    private:
+        bool m_first;
+    } pad;
+
+    std::cout << std::dec;
+
+    // put the fields
+    if (m.Vbat.fValid)
+        {
+        std::cout << pad.get() << "Vbat " << m.Vbat.v;
+        }
+
+    if (m.Vsys.fValid)
+        {
+        std::cout << pad.get() << "Vsys " << m.Vsys.v;
+        }
+
+    if (m.Boot.fValid)
+        {
+        std::cout << pad.get() << "Boot " << unsigned(m.Boot.v);
+        }
+
+    if (m.Temperature.fValid)
+        {
+        std::cout << pad.get() << "T " << m.Temperature.v;
+        }
+
+    if (m.Series.fValid)
+        {
+        const DpSeries &s = m.Series.v;
+
+        std::cout << pad.get() << "Series "
+                  << s.IntervalSec << " " << s.AgeSec << " "
+                  << s.ResolutionMilliPa << " " << s.Samples.size();
+        for (auto v : s.Samples)
+            std::cout << " " << v;
+        }
+
+    if (m.Diag.fValid)
+        {
+        const Diagnostics &d = m.Diag.v;
+
+        std::cout << pad.get() << "Diag"
+                  << " " << d.Transactions
+                  << " " << d.Nacks
+                  << " " << d.ShortReads
+                  << " " << d.LongReads
+                  << " " << d.CrcErrors
+                  << " " << d.WakeRetries
+                  << " " << d.BusyPolls;
+        for (auto v : d.LatencyHist)
+            std::cout << " " << v;
+        }
+
+    // make the syntax cut/pastable.
+    std::cout << pad.get() << ".\n";
+    }
+
+// print the input, the encoded message, and (from the reference decoder)
+// what a receiver will see.
+bool putTestVector(Measurements &m)
+    {
+    Buffer buf {};
+    Measurements decoded;
+    logMeasurement(m);
+    encodeMeasurement(buf, m);
+    bool fFirst;
+
+    fFirst = true;
+    for (auto v : buf)
+        {
+        if (! fFirst)
+            std::cout << " ";
+        fFirst = false;
+        std::cout.width(2);
+        std::cout.fill('0');
+        std::cout << std::hex << unsigned(v);
+        }
+    std::cout << "\n";
+
+    if (! decodeMeasurement(buf, decoded))
+        {
+        std::cout << "decode failed\n";
+        return false;
+        }
+
+    std::cout << "decoded: ";
+    logMeasurement(decoded);
+    return true;
+    }
+
+int main(int argc, char **argv)
+    {
+    Measurements m {};
+    Measurements m0 {};
+    bool fAny;
+    bool fResult;
+
+    std::cout << "Input a line with name/values pairs\n";
+
+    fAny = false;
+    fResult = true;
+    while (std::cin.good())
+        {
+        bool fUpdate = true;
+        key.clear();
+
+        std::cin >> key;
+
+        if (key == "Vbat")
+            {
+            std::cin >> m.Vbat.v;
+            m.Vbat.fValid = true;
+            }
+        else if (key == "Vsys")
+            {
+            std::cin >> m.Vsys.v;
+            m.Vsys.fValid = true;
+            }
+        else if (key == "Boot")
+            {
+            std::uint32_t nonce;
+            std::cin >> nonce;
+            m.Boot.v = (std::uint8_t) nonce;
+            m.Boot.fValid = true;
+            }
+        else if (key == "T")
+            {
+            std::cin >> m.Temperature.v;
+            m.Temperature.fValid = true;
+            }
+        else if (key == "Series")
+            {
+            DpSeries &s = m.Series.v;
+            unsigned n;
+
+            std::cin >> s.IntervalSec >> s.AgeSec >> s.ResolutionMilliPa >> n;
+            s.Samples.resize(n);
+            for (auto &v : s.Samples)
+                std::cin >> v;
+            m.Series.fValid = true;
+            }
+        else if (key == "Diag")
+            {
+            Diagnostics &d = m.Diag.v;
+
+            std::cin >> d.Transactions >> d.Nacks >> d.ShortReads >> d.LongReads
+                     >> d.CrcErrors >> d.WakeRetries >> d.BusyPolls;
+            for (auto &v : d.LatencyHist)
+                std::cin >> v;
+            m.Diag.fValid = true;
+            }
+        else if (key == ".")
+            {
+            fResult &= putTestVector(m);
+            m = m0;
+            fAny = false;
+            fUpdate = false;
+            }
+        else if (key == "")
+            /* ignore empty keys */
+            fUpdate = false;
+        else
+            {
+            std::cerr << "unknown key: " << key << "\n";
+            fUpdate = false;
+            }
+
+        fAny |= fUpdate;
+        }
+
+    if (!std::cin.eof() && std::cin.fail())
+        {
+        std::string nextword;
+
+        std::cin.clear(std::cin.goodbit);
+        std::cin >> nextword;
+        std::cerr << "parse error: " << nextword << "\n";
+        return 1;
+        }
+
+    if (fAny)
+        fResult &= putTestVector(m);
+
+    return fResult ? 0 : 1;
+    }
@@ -20,28 +20,196 @@ Author:
 */
 
 #include <MCCI_Catena_SDP.h>
+#include <MCCI_Catena_SDP_Calibration.h>
+
+#include <cstring>
 
 using namespace McciCatenaSdp;
 
+cSDP *cSDP::s_pAlertInstance[cSDP::kMaxAlertInstances];
+#if defined(ARDUINO)
+cArduinoClock cSDP::s_ArduinoClock;
+#endif
+
 bool cSDP::begin()
     {
     // if no Wire is bound, fail.
-    if (this->m_wire == nullptr)
+    if (this->m_pBus == nullptr || this->m_pClock == nullptr)
         return this->setLastError(Error::NoWire);
 
+    // begin() is called again to finish a start that was waiting for the
+    // sensor to wake up.
     if (this->isRunning())
-        return true;
+        {
+        if (this->m_fProductInfoChecked)
+            return true;
+        else
+            return this->identify();
+        }
 
-    this->m_wire->begin();
+    this->m_pBus->begin();
+    this->beginAlert();
     // the device might be asleep; assume nothing.
     this->m_state = State::Sleep;
-    return this->readProductInfo();
+    this->m_fProductInfoChecked = false;
+    return this->identify();
+    }
+
+// identify the sensor. On a warm restart (product info kept from a previous
+// begin(), or supplied by setProductInfo()), just confirm the product
+// number; if it changed, or if we know nothing, read the full product info.
+bool cSDP::identify()
+    {
+    if (this->m_fProductInfoValid)
+        {
+        if (this->verifyProductInfo())
+            {
+            this->m_fProductInfoChecked = true;
+            return true;
+            }
+
+        if (this->m_lastError != Error::ProductMismatch)
+            return false;
+
+        this->m_fProductInfoValid = false;
+        }
+
+    if (! this->readProductInfo())
+        return false;
+
+    this->m_fProductInfoChecked = true;
+    return true;
+    }
+
+// read just the product number (6 bytes, rather than 18), and compare it to
+// the saved product info.
+bool cSDP::verifyProductInfo()
+    {
+    std::uint8_t productNumberRaw[2 * 3];
+
+    if (! this->wakeup())
+        return false;
+
+    if (this->m_state != State::Idle)
+        return this->setLastError(Error::Busy);
+
+    if (! this->writeCommand(Command::ReadProductId1))
+        return false;
+
+    if (! this->writeCommand(Command::ReadProductId2))
+        return false;
+
+    if (! this->readResponse(productNumberRaw, sizeof(productNumberRaw)))
+        return false;
+
+    if (! this->crc_multi(productNumberRaw, sizeof(productNumberRaw)))
+        return false;
+
+    const std::uint32_t productNumber = (std::uint32_t(getUint16BE(&productNumberRaw[0])) << 16)
+                                      + (std::uint32_t(getUint16BE(&productNumberRaw[3])) <<  0);
+
+    if (productNumber != this->m_ProductInfo.ProductNumber)
+        return this->setLastError(Error::ProductMismatch);
+
+    return true;
+    }
+
+bool cSDP::setProductInfo(const ProductInfo &info)
+    {
+    if (this->isRunning())
+        return this->setLastError(Error::Busy);
+
+    if (! this->m_pProductOps->pIsExpectedProduct(info.ProductNumber))
+        return this->setLastError(Error::ProductMismatch);
+
+    this->m_ProductInfo = info;
+    this->m_fProductInfoValid = true;
+    this->resetProductState();
+    return true;
     }
 
 void cSDP::end()
     {
     if (this->isRunning())
+        {
+        this->endAlert();
         this->m_state = State::Uninitialized;
+        }
+    }
+
+// attach the alert pin (if any) to an interrupt. If no pin is configured,
+// or all slots are in use, readiness is determined by the timer alone.
+void cSDP::beginAlert()
+    {
+#if defined(ARDUINO)
+    if (this->m_pinAlert < 0 || this->m_alertSlot >= 0)
+        return;
+
+    static void (* const isrTable[kMaxAlertInstances])(void) =
+        {
+        &cSDP::alertIsrSlot<0>,
+        &cSDP::alertIsrSlot<1>,
+        &cSDP::alertIsrSlot<2>,
+        };
+
+    for (unsigned iSlot = 0; iSlot < kMaxAlertInstances; ++iSlot)
+        {
+        if (s_pAlertInstance[iSlot] == nullptr)
+            {
+            s_pAlertInstance[iSlot] = this;
+            this->m_alertSlot = std::int8_t(iSlot);
+            this->m_fAlert = false;
+
+            // IRQn is open drain, active low.
+            pinMode(this->m_pinAlert, INPUT_PULLUP);
+            attachInterrupt(digitalPinToInterrupt(this->m_pinAlert), isrTable[iSlot], FALLING);
+            return;
+            }
+        }
+#endif // defined(ARDUINO)
+    }
+
+void cSDP::endAlert()
+    {
+    if (this->m_alertSlot < 0)
+        return;
+
+#if defined(ARDUINO)
+    detachInterrupt(digitalPinToInterrupt(this->m_pinAlert));
+#endif
+    s_pAlertInstance[this->m_alertSlot] = nullptr;
+    this->m_alertSlot = -1;
+    this->m_fAlert = false;
+    }
+
+template <unsigned kSlot>
+void cSDP::alertIsrSlot()
+    {
+    cSDP * const pThis = s_pAlertInstance[kSlot];
+
+    if (pThis != nullptr)
+        pThis->alertIsr();
+    }
+
+void cSDP::alertIsr()
+    {
+    this->m_fAlert = true;
+    if (this->m_pAlertCallback != nullptr)
+        (*this->m_pAlertCallback)(this->m_pAlertClientData);
+    }
+
+// true if the alert pin says a result is ready. The pin level is checked as
+// well as the latched flag, in case the edge was missed.
+bool cSDP::checkAlert() const
+    {
+    if (this->m_alertSlot < 0)
+        return false;
+
+#if defined(ARDUINO)
+    return this->m_fAlert || digitalRead(this->m_pinAlert) == LOW;
+#else
+    return this->m_fAlert;
+#endif
     }
 
 bool cSDP::readProductInfo()
@@ -51,6 +219,11 @@ bool cSDP::readProductInfo()
     if (! this->wakeup())
         return false;
 
+    if (this->m_state != State::Idle)
+        return this->setLastError(Error::Busy);
+
+    this->m_fProductInfoValid = false;
+
     if (! this->writeCommand(Command::ReadProductId1))
         return false;
 
@@ -74,24 +247,47 @@ bool cSDP::readProductInfo()
 
     this->m_ProductInfo.ProductNumber = productNumber;
     this->m_ProductInfo.SerialNumber = serialNumber;
+    this->resetProductState();
+
+    if (! this->m_pProductOps->pIsExpectedProduct(productNumber))
+        return this->setLastError(Error::ProductMismatch);
 
+    this->m_fProductInfoValid = true;
     return true;
     }
 
+// wake the sensor, without waiting. The sensor may NACK the first
+// address probe after sleep; if so, the state becomes Waking, and this
+// returns false with Error::WakeupPending. A later call (after
+// kWakeupRetryMs) tries once more, and either completes the wakeup or
+// fails with Error::WakeupFailed.
 bool cSDP::wakeup()
     {
+    if (this->m_state == State::Waking)
+        {
+        if (std::int32_t(this->millis() - this->m_tWakeup) < 0)
+            return this->setLastError(Error::WakeupPending);
+
+        if (this->busWrite(nullptr, 0) != cBus::Status::Success)
+            {
+            // start over next time.
+            this->m_state = State::Sleep;
+            return this->setLastError(Error::WakeupFailed);
+            }
+
+        this->m_state = State::Idle;
+        return true;
+        }
+
     if (this->m_state != State::Sleep)
         return true;
 
-    // do a wakeup, and retry if it fails
-    this->m_wire->beginTransmission(std::uint8_t(this->m_address));
-    if (this->m_wire->endTransmission() != 0)
+    if (this->busWrite(nullptr, 0) != cBus::Status::Success)
         {
-        delay(2);
-        this->m_wire->beginTransmission(std::uint8_t(this->m_address));
-
-        if (this->m_wire->endTransmission() != 0)
-            return this->setLastError(Error::WakeupFailed);
+        this->countMetric(&Metrics::nWakeRetries);
+        this->m_state = State::Waking;
+        this->m_tWakeup = this->millis() + kWakeupRetryMs;
+        return this->setLastError(Error::WakeupPending);
         }
 
     this->m_state = State::Idle;
@@ -102,46 +298,111 @@ bool cSDP::writeCommand(cSDP::Command command)
     {
     const std::uint8_t cbuf[2] = { std::uint8_t(std::uint16_t(command) >> 8), std::uint8_t(command) };
 
-    this->m_wire->beginTransmission(std::uint8_t(this->m_address));
-    if (this->m_wire->write(cbuf, sizeof(cbuf)) != sizeof(cbuf))
-        return this->setLastError(Error::CommandWriteBufferFailed);
-    if (this->m_wire->endTransmission() != 0)
-        return this->setLastError(Error::CommandWriteFailed);
+    this->waitStopSettled();
+    return this->setBusError(this->busWrite(cbuf, sizeof(cbuf)));
+    }
 
-    return true;
+// after stopContinuousMeasurement(), the sensor ignores commands for a
+// while; if one is sent too soon, wait for it to settle.
+void cSDP::waitStopSettled()
+    {
+    if (! this->m_fStopSettling)
+        return;
+
+    while (this->m_pClock->millis() - this->m_tStop < kStopSettleMs)
+        this->m_pClock->delay(1);
+
+    this->m_fStopSettling = false;
     }
 
-bool cSDP::readResponse(std::uint8_t *buf, size_t nBuf)
+// all bus traffic goes through busWrite() and busRead(), so it can be counted.
+cBus::Status cSDP::busWrite(const std::uint8_t *pBuf, size_t nBuf)
     {
-    bool ok;
-    unsigned nResult;
-    const std::int8_t addr = this->getAddress();
-    uint8_t nReadFrom;
+    const cBus::Status status = this->m_pBus->write(std::uint8_t(this->m_address), pBuf, nBuf);
 
-    if (buf == nullptr || nBuf > 32 || addr < 0)
+    this->countMetric(&Metrics::nTransactions);
+    if (status == cBus::Status::Success)
+        this->countMetric(&Metrics::nBytes, nBuf);
+    else if (status == cBus::Status::WriteNack)
+        this->countMetric(&Metrics::nNacks);
+
+    return status;
+    }
+
+cBus::Status cSDP::busRead(std::uint8_t *pBuf, size_t nBuf)
+    {
+    const cBus::Status status = this->m_pBus->read(std::uint8_t(this->m_address), pBuf, nBuf);
+
+    this->countMetric(&Metrics::nTransactions);
+    switch (status)
         {
-        return this->setLastError(Error::InternalInvalidParameter);
+    case cBus::Status::Success:
+        this->countMetric(&Metrics::nBytes, nBuf);
+        break;
+    case cBus::Status::ReadRequest:
+        this->countMetric(&Metrics::nNacks);
+        break;
+    case cBus::Status::ReadShort:
+        this->countMetric(&Metrics::nShortReads);
+        break;
+    case cBus::Status::ReadLong:
+        this->countMetric(&Metrics::nLongReads);
+        break;
+    default:
+        break;
         }
 
-    nReadFrom = this->m_wire->requestFrom(std::uint8_t(addr), /* bytes */ std::uint8_t(nBuf));
+    return status;
+    }
+
+#if MCCI_CATENA_SDP_METRICS
+void cSDP::recordLatency(std::uint32_t ms)
+    {
+    Metrics &m = this->m_Metrics;
+    const std::uint16_t ms16 = ms > UINT16_MAX ? UINT16_MAX : std::uint16_t(ms);
+    std::uint16_t &bin = m.LatencyHist[Metrics::getLatencyBin(ms)];
+
+    if (bin != UINT16_MAX)
+        ++bin;
+    if (ms16 < m.LatencyMinMs)
+        m.LatencyMinMs = ms16;
+    if (ms16 > m.LatencyMaxMs)
+        m.LatencyMaxMs = ms16;
+    }
+#endif
 
-    if (nReadFrom != nBuf)
+// map a bus status to an error, and return true for success.
+bool cSDP::setBusError(cBus::Status status)
+    {
+    switch (status)
         {
+    case cBus::Status::Success:
+        return true;
+    case cBus::Status::WriteBufferFailed:
+        return this->setLastError(Error::CommandWriteBufferFailed);
+    case cBus::Status::WriteNack:
+        return this->setLastError(Error::CommandWriteFailed);
+    case cBus::Status::ReadRequest:
         return this->setLastError(Error::I2cReadRequest);
-        }
-    nResult = this->m_wire->available();
-    if (nResult > nBuf)
+    case cBus::Status::ReadLong:
         return this->setLastError(Error::I2cReadLong);
+    case cBus::Status::ReadShort:
+        return this->setLastError(Error::I2cReadShort);
+    default:
+        return this->setLastError(Error::InternalInvalidParameter);
+        }
+    }
 
-    for (unsigned i = 0; i < nResult; ++i)
-        buf[i] = this->m_wire->read();
+bool cSDP::readResponse(std::uint8_t *buf, size_t nBuf)
+    {
+    const std::int8_t addr = this->getAddress();
 
-    if (nResult != nBuf)
+    if (buf == nullptr || nBuf > 32 || addr < 0)
         {
-        return this->setLastError(Error::I2cReadShort);
+        return this->setLastError(Error::InternalInvalidParameter);
         }
 
-    return true;
+    return this->setBusError(this->busRead(buf, nBuf));
     }
 
 bool cSDP::startTriggeredMeasurement()
@@ -152,12 +413,99 @@ bool cSDP::startTriggeredMeasurement()
     if (this->m_state != State::Idle)
         return this->setLastError(Error::Busy);
 
-    bool result = this->writeCommand(Command::StartTriggeredDifferential_Poll);
+    this->clearAlert();
+    this->m_fMeasurementBuffered = false;
+    bool result = this->writeCommand(getTriggeredCommand(this->m_mode, false));
 
     if (result)
         {
+        // start probing a little before we expect the data.
+        std::uint32_t tProbe = this->getConversionEstimateMs();
+
+        tProbe = tProbe > kProbeLeadMs ? tProbe - kProbeLeadMs : 0;
+
         this->m_state = State::Triggered;
-        this->m_tReady = millis() + 46;
+        this->m_tStart = this->millis();
+        this->m_tReady = this->m_tStart + tProbe;
+        }
+
+    return result;
+    }
+
+bool cSDP::startContinuousMeasurement(cSDP::Averaging averaging)
+    {
+    if (! this->wakeup())
+        return false;
+
+    if (this->m_state != State::Idle)
+        return this->setLastError(Error::Busy);
+
+    this->clearAlert();
+    bool result = this->writeCommand(getContinuousCommand(this->m_mode, averaging));
+
+    if (result)
+        {
+        this->m_state = State::Continuous;
+        this->m_SampleRing.clear();
+        this->m_tReady = this->millis() + kContinuousStartupMs;
+        }
+
+    return result;
+    }
+
+// make a measurement in a single transaction, using clock stretching. The
+// sensor holds SCL low after the read header until the conversion is done;
+// the read is retried in case the bus master gives up on a long stretch.
+bool cSDP::measureBlocking(std::uint32_t timeoutMs)
+    {
+    // this call blocks anyway, so wait out a pending wakeup.
+    while (! this->wakeup())
+        {
+        if (this->m_lastError != Error::WakeupPending)
+            return false;
+        this->m_pClock->delay(1);
+        }
+
+    if (this->m_state != State::Idle)
+        return this->setLastError(Error::Busy);
+
+    this->clearAlert();
+    this->m_fMeasurementBuffered = false;
+    if (! this->writeCommand(getTriggeredCommand(this->m_mode, true)))
+        return false;
+
+    this->m_state = State::Triggered;
+    this->m_tStart = this->millis();
+
+    while (! this->tryReadMeasurementBuffer())
+        {
+        if (this->millis() - this->m_tStart > timeoutMs)
+            {
+            this->m_state = State::Idle;
+            return this->setLastError(Error::Timeout);
+            }
+        }
+
+    return this->readMeasurement();
+    }
+
+bool cSDP::stopContinuousMeasurement()
+    {
+    if (! checkRunning())
+        return false;
+
+    if (this->m_state != State::Continuous)
+        return this->setLastError(Error::NotMeasuring);
+
+    bool result = this->writeCommand(Command::StopContinuousMeasurement);
+
+    // the sensor accepts commands again 500 us after the stop command;
+    // the next writeCommand() waits if need be, so we needn't.
+    if (result)
+        {
+        this->m_tStop = this->m_pClock->millis();
+        this->m_fStopSettling = true;
+        this->m_state = State::Idle;
         }
 
     return result;
@@ -168,76 +516,188 @@ bool cSDP::queryReady()
     if (! checkRunning())
         return false;
 
-    if (this->m_state != State::Triggered)
+    if (! (this->m_state == State::Triggered || this->m_state == State::Continuous))
         return this->setLastError(Error::NotMeasuring);
 
-    if (std::int32_t(millis() - this->m_tReady) < 0)
+    // the alert pin, if present, reports completion early; the timer
+    // covers parts and firmware that don't drive IRQn.
+    if (this->checkAlert())
+        return true;
+
+    if (std::int32_t(this->millis() - this->m_tReady) < 0)
         {
+        this->countMetric(&Metrics::nBusyPolls);
         return this->setLastError(Error::Busy);
         }
 
+    // in continuous mode, data is always available once started.
+    if (this->m_state == State::Continuous)
+        return true;
+
+    // the sensor NACKs reads until conversion is complete, so just try
+    // the read.
+    if (this->probeMeasurement())
+        return true;
+
+    if (this->m_lastError == Error::Busy)
+        this->countMetric(&Metrics::nBusyPolls);
+    return false;
+    }
+
+bool cSDP::probeMeasurement()
+    {
+    if (this->m_fMeasurementBuffered)
+        return true;
+
+    const std::uint32_t tNow = this->millis();
+
+    if (this->tryReadMeasurementBuffer())
+        {
+        this->updateConversionEstimate(tNow - this->m_tStart);
+        return true;
+        }
+
+    // not ready. Give up if we're well past the worst case.
+    const std::uint32_t tLimit = this->m_pProductOps->pGetConversionMaxMs(*this) + kProbeTimeoutMs;
+    if (tNow - this->m_tStart > tLimit)
+        {
+        this->m_state = State::Idle;
+        return this->setLastError(Error::Timeout);
+        }
+
+    this->m_tReady = tNow + kProbeIntervalMs;
+    return this->setLastError(Error::Busy);
+    }
+
+bool cSDP::setMode(cSDP::Mode mode)
+    {
+    if (this->m_state == State::Triggered || this->m_state == State::Continuous)
+        return this->setLastError(Error::Busy);
+
+    this->m_mode = mode;
     return true;
     }
 
+void cSDP::setReadProfile(cSDP::ReadProfile profile, std::uint8_t nTemperatureInterval)
+    {
+    this->m_readProfile = profile;
+    this->m_nTemperatureInterval = nTemperatureInterval;
+    this->m_nSinceTemperature = 0;
+    }
+
+// attempt to read a measurement into m_measurementBuffer. Returns false
+// (without setting an error) if the sensor NACKs or the read is short.
+bool cSDP::tryReadMeasurementBuffer()
+    {
+    const std::uint8_t nBuf = this->getMeasurementLength();
+
+    this->m_nMeasurementBuffer = nBuf;
+    if (this->busRead(this->m_measurementBuffer, nBuf) == cBus::Status::Success)
+        {
+        if (this->m_state == State::Triggered)
+            this->recordLatency(this->millis() - this->m_tStart);
+        this->m_fMeasurementBuffered = true;
+        return true;
+        }
+
+    return false;
+    }
+
 bool cSDP::readMeasurement()
     {
     if (! checkRunning())
         return false;
 
-    if (this->m_state != State::Triggered)
+    if (! (this->m_state == State::Triggered || this->m_state == State::Continuous))
         return this->setLastError(Error::NotMeasuring);
 
-    std::uint8_t measurementBuffer[3 * 3];
-    bool result = this->readResponse(measurementBuffer, sizeof(measurementBuffer));
-    this->m_state = State::Idle;
+    std::uint8_t * const measurementBuffer = this->m_measurementBuffer;
+    bool result;
+
+    // use the data fetched by queryReady() if we have it.
+    if (this->m_fMeasurementBuffered)
+        {
+        this->m_fMeasurementBuffered = false;
+        result = true;
+        }
+    else
+        {
+        this->m_nMeasurementBuffer = this->getMeasurementLength();
+        result = this->readResponse(measurementBuffer, this->m_nMeasurementBuffer);
+        if (result && this->m_state == State::Triggered)
+            this->recordLatency(this->millis() - this->m_tStart);
+        }
+    const std::uint8_t nBuf = this->m_nMeasurementBuffer;
+
+    // in continuous mode, the sensor keeps measuring; no need to re-trigger.
+    if (this->m_state == State::Triggered)
+        this->m_state = State::Idle;
+
+    // the alert has been consumed.
+    this->clearAlert();
 
     if (result)
         {
-        result = this->crc_multi(measurementBuffer, sizeof(measurementBuffer));
+        result = this->crc_multi(measurementBuffer, nBuf);
         }
 
     if (result)
         {
-        MeasurementRaw m;
+        // fields that weren't read keep their previous values.
+        MeasurementRaw m = this->m_MeasurementRaw;
+
         m.DifferentialPressureBits = getInt16BE(&measurementBuffer[0]);
-        m.TemperatureBits = getInt16BE(&measurementBuffer[3]);
-        m.ScaleBits = getUint16BE(&measurementBuffer[6]);
+        m.MeasurementMode = this->m_mode;
+
+        if (nBuf >= 6)
+            {
+            m.TemperatureBits = getInt16BE(&measurementBuffer[3]);
+            this->m_nSinceTemperature = 0;
+            }
+        else
+            ++this->m_nSinceTemperature;
+
+        if (nBuf >= 9)
+            {
+            m.ScaleBits = getUint16BE(&measurementBuffer[6]);
+            this->m_fScaleValid = true;
+            }
 
         this->m_MeasurementRaw = m;
-        this->m_Measurement.set(m);
+
+        if (this->m_state == State::Continuous)
+            this->m_SampleRing.put(m);
         }
 
     return result;
     }
 
-std::uint8_t cSDP::crc(const std::uint8_t * buf, size_t nBuf, std::uint8_t crc8)
+// the calibration correction is applied in mPa, as the raw data is
+// converted; the raw data is left as the sensor sent it.
+cSDP::MeasurementFixed cSDP::getMeasurementFixed(const cSDP::MeasurementRaw &mRaw) const
     {
-    /* see cSHT3x CRC-8-Calc.md for a little info on this */
-    static const std::uint8_t crcTable[16] =
-        {
-        0x00, 0x31, 0x62, 0x53, 0xc4, 0xf5, 0xa6, 0x97,
-        0xb9, 0x88, 0xdb, 0xea, 0x7d, 0x4c, 0x1f, 0x2e,
-        };
+    MeasurementFixed m;
 
-    for (size_t i = nBuf; i > 0; --i, ++buf)
-        {
-        uint8_t b, p;
-
-        // calculate first nibble
-        b = *buf;
-        p = (b ^ crc8) >> 4;
-        crc8 = (crc8 << 4) ^ crcTable[p];
-
-        // calculate second nibble
-        // this could be written as:
-        //      b <<= 4;
-        //      p = (b ^ crc8) >> 4;
-        // but it's more effective as:
-        p = ((crc8 >> 4) ^ b) & 0xF;
-        crc8 = (crc8 << 4) ^ crcTable[p];
-        }
+    m.set(mRaw);
+    if (this->m_pCalibration != nullptr && this->m_fProductInfoValid)
+        this->m_pCalibration->apply(this->m_ProductInfo.SerialNumber, m);
 
-    return crc8;
+    return m;
+    }
+
+cSDP::Measurement cSDP::getMeasurement(const cSDP::MeasurementRaw &mRaw) const
+    {
+    Measurement m;
+    std::int32_t offset;
+
+    m.set(mRaw);
+    if (this->m_pCalibration != nullptr && this->m_fProductInfoValid &&
+        this->m_pCalibration->getOffsetMilliPa(
+                this->m_ProductInfo.SerialNumber, rawTtoMilliCelsius(mRaw.TemperatureBits), offset
+                ))
+        m.DifferentialPressure -= float(offset) / 1000.0f;
+
+    return m;
     }
 
 bool cSDP::crc_multi(const std::uint8_t *buf, size_t nbuf)
@@ -245,15 +705,20 @@ bool cSDP::crc_multi(const std::uint8_t *buf, size_t nbuf)
     if (buf == nullptr)
         return this->setLastError(Error::InternalInvalidParameter);
 
-    for (; nbuf >= 3; buf += 3, nbuf -= 3)
+    if (nbuf % cCrc8::kBytesPerWord != 0)
+        return this->setLastError(Error::InternalInvalidParameter);
+
+    // check the whole burst in one pass, and remember which word failed.
+    const std::size_t iBad = cCrc8::validateBurst(buf, nbuf / cCrc8::kBytesPerWord);
+
+    if (iBad != cCrc8::kBatchSuccess)
         {
-        if (this->crc(buf, 2) != buf[2])
-            return this->setLastError(Error::Crc);
+        this->m_crcErrorWord = std::int8_t(iBad);
+        this->countMetric(&Metrics::nCrcErrors);
+        return this->setLastError(Error::Crc);
         }
 
-    if (nbuf != 0)
-        return this->setLastError(Error::InternalInvalidParameter);
-
+    this->m_crcErrorWord = -1;
     return true;
     }
 
@@ -265,6 +730,14 @@ bool cSDP::sleep()
     if (this->m_state == State::Sleep)
         return true;
 
+    // if we were waking it up, just treat it as asleep; if it did wake,
+    // the next wakeup() will succeed on the first try.
+    if (this->m_state == State::Waking)
+        {
+        this->m_state = State::Sleep;
+        return true;
+        }
+
     // can't send command if we're idle
     if (! (this->m_state == State::Idle))
         return this->setLastError(Error::Busy);
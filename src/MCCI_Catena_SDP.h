@@ -18,7 +18,20 @@ Author:
 # pragma once
 
 #include <cstdint>
-#include <Wire.h>
+#include <MCCI_Catena_SDP_Bus.h>
+#include <MCCI_Catena_SDP_Crc.h>
+
+/// \brief enable driver telemetry.
+///
+/// \details
+///     If non-zero, each cSDP keeps counters of bus activity and errors,
+///     and a histogram of measurement latency; see cSDP::getMetrics(). If
+///     zero (the default), the counters and the code that maintains them
+///     are compiled out.
+///
+#ifndef MCCI_CATENA_SDP_METRICS
+# define MCCI_CATENA_SDP_METRICS 0
+#endif
 
 namespace McciCatenaSdp {
 
@@ -62,11 +75,75 @@ getLocal(std::uint32_t v)
 // version of library, for use by clients in static_asserts
 static constexpr std::uint32_t kVersion = makeVersion(1,0,1,0);
 
+// a fixed-size ring of samples; when full, the oldest entry is overwritten.
+// kN must be a power of two.
+template <typename T, unsigned kN>
+class cSampleRing
+    {
+    static_assert(kN != 0 && (kN & (kN - 1)) == 0, "kN must be a power of two");
+
+public:
+    static constexpr unsigned kSize = kN;
+
+    void clear()
+        {
+        this->m_head = this->m_tail = 0;
+        this->m_overruns = 0;
+        }
+    unsigned getCount() const
+        {
+        return unsigned(this->m_head - this->m_tail);
+        }
+    bool isEmpty() const
+        {
+        return this->m_head == this->m_tail;
+        }
+    // number of samples discarded because the ring was full.
+    std::uint32_t getOverruns() const
+        {
+        return this->m_overruns;
+        }
+    void put(const T &v)
+        {
+        if (this->getCount() == kN)
+            {
+            ++this->m_tail;
+            ++this->m_overruns;
+            }
+        this->m_buf[this->m_head++ & (kN - 1)] = v;
+        }
+    bool get(T &v)
+        {
+        if (this->isEmpty())
+            return false;
+        v = this->m_buf[this->m_tail++ & (kN - 1)];
+        return true;
+        }
+
+private:
+    T m_buf[kN];
+    std::uint16_t m_head = 0;       /// index of next entry to write (mod 2^16)
+    std::uint16_t m_tail = 0;       /// index of oldest entry (mod 2^16)
+    std::uint32_t m_overruns = 0;   /// count of overwritten samples
+    };
+
+class cSDPCalibration;
+struct cSDPGenericTraits;
+
 class cSDP
     {
 private:
     static constexpr bool kfDebug = false;
 
+protected:
+    // the product-dependent steps of the driver. A cSDP constructed
+    // directly uses the cSDPGenericTraits versions, which work with any
+    // product and find out which at runtime. cSDPProduct<> supplies
+    // versions built from cSDPProductTraits<>, in which the product is a
+    // constant; the tests on it fold away, and (with --gc-sections) the
+    // generic versions aren't linked.
+    struct ProductOps;
+
 public:
     // the address type:
     enum class Address : std::int8_t
@@ -81,11 +158,25 @@ public:
     // the type for pin assignments, in case it's an SDP3x and has an int pin.
     using Pin_t = std::int8_t;
 
+    // the type for alert callbacks. Called from interrupt context when the
+    // alert pin signals that a measurement is ready.
+    using AlertCallback_t = void (void *pClientData);
+
+    // maximum number of instances that can use an alert pin at once. The
+    // SDP3x is the only family with an IRQn pin, and has three addresses.
+    static constexpr unsigned kMaxAlertInstances = 3;
+
+#if defined(ARDUINO)
     // constructor
     cSDP(TwoWire &wire, Address Address = Address::SDP3x_A, Pin_t pinAlert = -1)
-        : m_wire(&wire)
-        , m_address(Address)
-        , m_pinAlert(pinAlert)
+        : cSDP(wire, Address, pinAlert, getProductOps<cSDPGenericTraits>())
+        {}
+#endif
+
+    // constructor, for use with an arbitrary bus and clock (e.g. for
+    // simulation on a host).
+    cSDP(cBus &bus, cClock &clock, Address Address = Address::SDP3x_A, Pin_t pinAlert = -1)
+        : cSDP(bus, clock, Address, pinAlert, getProductOps<cSDPGenericTraits>())
         {}
 
     // neither copyable nor movable
@@ -94,6 +185,13 @@ public:
     cSDP(const cSDP&&) = delete;
     cSDP& operator=(const cSDP&&) = delete;
 
+    // the temperature compensation used by the sensor.
+    enum class Mode : std::uint8_t
+        {
+        DifferentialPressure,   // compensated for differential pressure
+        MassFlow,               // compensated for mass flow (bypass config)
+        };
+
     static constexpr float rawTtoCelsius(std::int16_t tfrac)
         {
         return float(tfrac) / 200.0f;
@@ -104,12 +202,28 @@ public:
         return float(diffP) / float(scale);
         }
 
+    // integer conversions: temperature in milli-degrees Celsius (exact),
+    // and differential pressure in milli-Pascals (rounded to nearest).
+    static constexpr std::int32_t rawTtoMilliCelsius(std::int16_t tfrac)
+        {
+        return std::int32_t(tfrac) * 5;
+        }
+
+    static constexpr std::int32_t rawDiffPtoMilliPascal(std::int16_t diffP, std::uint16_t scale)
+        {
+        return (scale == 0) ? 0
+            :  (diffP >= 0) ?   (std::int32_t(diffP) * 1000 + scale / 2) / std::int32_t(scale)
+            :                 -((-std::int32_t(diffP) * 1000 + scale / 2) / std::int32_t(scale))
+            ;
+        }
+
     // raw measurement as a collection.
     struct MeasurementRaw
         {
         std::int16_t   TemperatureBits;
         std::int16_t   DifferentialPressureBits;
         std::uint16_t   ScaleBits;
+        Mode            MeasurementMode;
         void extract(std::int16_t &a_t, std::int16_t &a_dp, std::uint16_t &a_scale) const
             {
             a_t = this->TemperatureBits;
@@ -123,10 +237,12 @@ public:
         {
         float Temperature;
         float DifferentialPressure;
+        Mode MeasurementMode;
         void set(MeasurementRaw const & mRaw)
             {
             this->Temperature = rawTtoCelsius(mRaw.TemperatureBits);
             this->DifferentialPressure = rawDiffPtoPascal(mRaw.DifferentialPressureBits, mRaw.ScaleBits);
+            this->MeasurementMode = mRaw.MeasurementMode;
             }
         void extract(float &a_t, float &a_dp) const
             {
@@ -135,6 +251,34 @@ public:
             }
         };
 
+    // measurements as integers, for use without floating point.
+    struct MeasurementFixed
+        {
+        std::int32_t TemperatureMilliC;             // milli-degrees Celsius
+        std::int32_t DifferentialPressureMilliPa;   // milli-Pascals
+        Mode MeasurementMode;
+        void set(MeasurementRaw const & mRaw)
+            {
+            this->TemperatureMilliC = rawTtoMilliCelsius(mRaw.TemperatureBits);
+            this->DifferentialPressureMilliPa = rawDiffPtoMilliPascal(mRaw.DifferentialPressureBits, mRaw.ScaleBits);
+            this->MeasurementMode = mRaw.MeasurementMode;
+            }
+        void extract(std::int32_t &a_t, std::int32_t &a_dp) const
+            {
+            a_t = this->TemperatureMilliC;
+            a_dp = this->DifferentialPressureMilliPa;
+            }
+        // conversions to floating point, on demand.
+        float getTemperature() const
+            {
+            return float(this->TemperatureMilliC) / 1000.0f;
+            }
+        float getDifferentialPressure() const
+            {
+            return float(this->DifferentialPressureMilliPa) / 1000.0f;
+            }
+        };
+
     // product ID info
     struct ProductInfo
         {
@@ -142,6 +286,47 @@ public:
         std::uint32_t   ProductNumber;
         };
 
+    // driver telemetry, maintained if MCCI_CATENA_SDP_METRICS is non-zero.
+    struct Metrics
+        {
+        // the latency histogram: bin 0 counts triggered measurements whose
+        // data arrived in less than kLatencyBaseMs + kLatencyBinMs ms; each
+        // bin after that is kLatencyBinMs wide; the last bin also counts
+        // everything slower.
+        static constexpr unsigned kLatencyBins = 8;
+        static constexpr std::uint32_t kLatencyBaseMs = 30;
+        static constexpr std::uint32_t kLatencyBinMs = 4;
+
+        std::uint32_t   nTransactions;  ///< bus transactions (reads and writes)
+        std::uint32_t   nBytes;         ///< bytes moved, excluding addresses
+        std::uint32_t   nNacks;         ///< transactions NACKed by the sensor
+        std::uint32_t   nShortReads;    ///< reads that returned too few bytes
+        std::uint32_t   nLongReads;     ///< reads that returned too many bytes
+        std::uint32_t   nCrcErrors;     ///< reads that failed the CRC check
+        std::uint32_t   nWakeRetries;   ///< wakeups that needed a second try
+        std::uint32_t   nBusyPolls;     ///< queryReady() calls that returned Busy
+        std::uint16_t   LatencyMinMs;   ///< fastest triggered measurement
+        std::uint16_t   LatencyMaxMs;   ///< slowest triggered measurement
+        std::uint16_t   LatencyHist[kLatencyBins];
+
+        static constexpr unsigned getLatencyBin(std::uint32_t ms)
+            {
+            return (ms < kLatencyBaseMs + kLatencyBinMs) ? 0
+                 : (ms >= kLatencyBaseMs + kLatencyBins * kLatencyBinMs) ? kLatencyBins - 1
+                 : unsigned((ms - kLatencyBaseMs) / kLatencyBinMs)
+                 ;
+            }
+        std::uint32_t getLatencyCount() const
+            {
+            std::uint32_t n = 0;
+            for (auto v : this->LatencyHist)
+                n += v;
+            return n;
+            }
+        };
+
+    static constexpr bool kfMetrics = MCCI_CATENA_SDP_METRICS != 0;
+
     enum class ProductId_t : std::uint32_t
         {
         SDP31       = 0x03010101,
@@ -168,6 +353,59 @@ public:
             ;
         }
 
+    // the product families; the upper half of the product number.
+    enum class ProductFamily : std::uint8_t
+        {
+        Unknown,
+        SDP3x,
+        SDP8xx,
+        };
+
+    static constexpr ProductFamily getProductFamily(ProductId_t id)
+        {
+        return ((std::uint32_t(id) >> 16) == 0x0301) ? ProductFamily::SDP3x
+            :  ((std::uint32_t(id) >> 16) == 0x0302) ? ProductFamily::SDP8xx
+            :  ProductFamily::Unknown
+            ;
+        }
+
+    // the DP scale factor (counts per Pascal) for each product, or zero
+    // if not known.
+    static constexpr std::uint16_t getProductScale(ProductId_t id)
+        {
+        return (id == ProductId_t::SDP31)       ? 60
+            :  (id == ProductId_t::SDP32)       ? 240
+            :  (id == ProductId_t::SDP800_500)  ? 60
+            :  (id == ProductId_t::SDP810_500)  ? 60
+            :  (id == ProductId_t::SDP801_500)  ? 60
+            :  (id == ProductId_t::SDP811_500)  ? 60
+            :  (id == ProductId_t::SDP800_125)  ? 240
+            :  (id == ProductId_t::SDP810_125)  ? 240
+            :  0
+            ;
+        }
+
+    // true if the address can be used by the product family.
+    static constexpr bool isValidAddress(ProductFamily family, Address address)
+        {
+        return (family == ProductFamily::SDP3x)
+                    ? (address == Address::SDP3x_A ||
+                       address == Address::SDP3x_B ||
+                       address == Address::SDP3x_C)
+            :  (family == ProductFamily::SDP8xx)
+                    ? address == Address::SDP8xx
+            :  false
+            ;
+        }
+
+    // worst-case conversion time for a triggered measurement, in ms.
+    static constexpr std::uint32_t getTriggeredConversionMaxMs(ProductFamily family)
+        {
+        return (family == ProductFamily::SDP3x) ? 45
+            :  46
+            ;
+        }
+
     // the commands
     enum class Command : std::uint16_t
         {
@@ -182,6 +420,7 @@ public:
         ReadProductId1                          =   0x367C,
         StartTriggeredMassflow_Stretch          =   0x3726,
         StartTriggeredDifferential_Stretch      =   0x372D,
+        StopContinuousMeasurement               =   0x3FF9,
         ReadProductId2                          =   0xE102,
         };
 
@@ -201,8 +440,51 @@ public:
         NotMeasuring,
         Crc,
         Uninitialized,
+        Timeout,
+        ProductMismatch,
+        WakeupPending,
+        };
+
+    // the continuous-measurement flavors
+    enum class Averaging : std::uint8_t
+        {
+        Average,        // sensor averages all conversions until read
+        Point,          // sensor returns the most recent conversion
         };
 
+    // which fields to read for each measurement. The scale factor is
+    // always read with the first measurement after begin(), and cached.
+    enum class ReadProfile : std::uint8_t
+        {
+        Full,                           // DP, temperature and scale (9 bytes)
+        DiffPressureAndTemperature,     // DP and temperature (6 bytes)
+        DiffPressure,                   // DP only (3 bytes)
+        };
+
+    // samples from continuous measurement are kept in a ring of this size.
+    static constexpr unsigned kSampleRingSize = 16;
+    using SampleRing_t = cSampleRing<MeasurementRaw, kSampleRingSize>;
+
+    // milliseconds from start of continuous measurement to first result
+    static constexpr std::uint32_t kContinuousStartupMs = 8;
+    // the conversion time for a triggered measurement, in milliseconds,
+    // used until the product is known.
+    static constexpr std::uint32_t kTriggeredConversionMs = 46;
+    // start probing this many ms before the estimated conversion time.
+    static constexpr std::uint32_t kProbeLeadMs = 2;
+    // minimum spacing of readiness probes, in ms.
+    static constexpr std::uint32_t kProbeIntervalMs = 1;
+    // give up if no data this many ms after the worst-case conversion time.
+    static constexpr std::uint32_t kProbeTimeoutMs = 10;
+    // if the sensor doesn't respond to the first wakeup, wait this many ms
+    // before trying again.
+    static constexpr std::uint32_t kWakeupRetryMs = 2;
+    // the sensor ignores commands for 500 us after a stop command. The
+    // clock counts whole ms, so wait for two ticks to be sure.
+    static constexpr std::uint32_t kStopSettleMs = 2;
+    // default timeout for measureBlocking(), in ms.
+    static constexpr std::uint32_t kMeasureBlockingTimeoutMs = 60;
+
 private:
     // this is internal -- centralize it but require that clients call the
     // public method (which centralizes the strings and the search)
@@ -220,6 +502,9 @@ private:
         "NotMeasuring\0"
         "Crc\0"
         "Uninitialized\0"
+        "Timeout\0"
+        "ProductMismatch\0"
+        "WakeupPending\0"
         ;
 
 public:
@@ -227,12 +512,66 @@ public:
     bool begin();
     void end();
     bool startTriggeredMeasurement();
+    bool measureBlocking(std::uint32_t timeoutMs = kMeasureBlockingTimeoutMs);
+    bool startContinuousMeasurement(Averaging averaging = Averaging::Average);
+    bool stopContinuousMeasurement();
     bool queryReady();
     bool readMeasurement();
-    float getTemperature() const { return this->m_Measurement.Temperature; }
-    float getDifferentialPressure() const { return this->m_Measurement.DifferentialPressure; }
-    Measurement getMeasurement() const { return this->m_Measurement; }
+    // true if the alert pin has signaled since the last measurement started.
+    bool isAlertPending() const { return this->m_fAlert; }
+    // true if an alert pin is configured and attached to an interrupt.
+    bool hasAlert() const { return this->m_alertSlot >= 0; }
+    // register a function to be called (from interrupt context) on alert.
+    void setAlertCallback(AlertCallback_t *pCallback, void *pClientData)
+        {
+        this->m_pAlertCallback = pCallback;
+        this->m_pAlertClientData = pClientData;
+        }
+    // select the temperature compensation; can't be changed while measuring.
+    bool setMode(Mode mode);
+    Mode getMode() const { return this->m_mode; }
+    // select the read profile. For ReadProfile::DiffPressure, temperature
+    // is refreshed every nTemperatureInterval samples (0 means never).
+    void setReadProfile(ReadProfile profile, std::uint8_t nTemperatureInterval = 0);
+    ReadProfile getReadProfile() const { return this->m_readProfile; }
+    // the floating-point results are computed on demand from the raw data;
+    // nothing in the measurement path uses floating point. The converted
+    // results include the calibration correction, if any; the raw data is
+    // as read from the sensor.
+    float getTemperature() const
+        {
+        return rawTtoCelsius(this->m_MeasurementRaw.TemperatureBits);
+        }
+    float getDifferentialPressure() const
+        {
+        return this->getMeasurement().DifferentialPressure;
+        }
+    Measurement getMeasurement() const
+        {
+        return this->getMeasurement(this->m_MeasurementRaw);
+        }
+    MeasurementFixed getMeasurementFixed() const
+        {
+        return this->getMeasurementFixed(this->m_MeasurementRaw);
+        }
+    // convert a raw result from this sensor (for example, from getSample()).
+    Measurement getMeasurement(const MeasurementRaw &mRaw) const;
+    MeasurementFixed getMeasurementFixed(const MeasurementRaw &mRaw) const;
     MeasurementRaw getRawMeasurement() const { return this->m_MeasurementRaw; }
+    // correct each converted reading's DP using the sensor's entry (if
+    // any) in a calibration table; nullptr for no correction.
+    void setCalibration(const cSDPCalibration *pCalibration)
+        {
+        this->m_pCalibration = pCalibration;
+        }
+    const cSDPCalibration *getCalibration() const
+        {
+        return this->m_pCalibration;
+        }
+    // fetch oldest sample from the continuous-measurement ring.
+    bool getSample(MeasurementRaw &m) { return this->m_SampleRing.get(m); }
+    unsigned getSampleCount() const { return this->m_SampleRing.getCount(); }
+    std::uint32_t getSampleOverruns() const { return this->m_SampleRing.getOverruns(); }
     Error getLastError() const
         {
         return this->m_lastError;
@@ -242,6 +581,29 @@ public:
         this->m_lastError = e;
         return e == Error::Success;
         }
+    // copy the telemetry counters; returns false if they're compiled out.
+    bool getMetrics(Metrics &m) const
+        {
+#if MCCI_CATENA_SDP_METRICS
+        m = this->m_Metrics;
+        return true;
+#else
+        (void) m;
+        return false;
+#endif
+        }
+    void resetMetrics()
+        {
+#if MCCI_CATENA_SDP_METRICS
+        this->m_Metrics = Metrics {};
+        this->m_Metrics.LatencyMinMs = UINT16_MAX;
+#endif
+        }
+    // index of the word that failed the last CRC check, or -1.
+    std::int8_t getCrcErrorWord() const
+        {
+        return this->m_crcErrorWord;
+        }
     static const char *getErrorName(Error e);
     const char *getLastErrorName() const
         {
@@ -251,16 +613,57 @@ public:
         {
         return getProductName(ProductId_t(this->m_ProductInfo.ProductNumber));
         }
+    ProductFamily getProductFamily() const
+        {
+        return getProductFamily(ProductId_t(this->m_ProductInfo.ProductNumber));
+        }
+    // return the current estimate of triggered conversion time, in ms.
+    std::uint32_t getConversionEstimateMs() const
+        {
+        return (this->m_convEstimate16 + 15) >> 4;
+        }
+    cBus *getBus() const
+        {
+        return this->m_pBus;
+        }
+    std::int8_t getAddressValue() const
+        {
+        return this->getAddress();
+        }
     std::uint64_t getSerialNumber() const
         {
         return this->m_ProductInfo.SerialNumber;
         }
+    // read the full product info from the sensor.
     bool readProductInfo();
+    // the product info, and whether it's known. It's kept across end() and
+    // begin(), so begin() only needs to confirm the product number.
+    bool getProductInfo(ProductInfo &info) const
+        {
+        info = this->m_ProductInfo;
+        return this->m_fProductInfoValid;
+        }
+    bool isProductInfoValid() const
+        {
+        return this->m_fProductInfoValid;
+        }
+    // restore product info (for example, from retained storage after a
+    // reset) before begin(); fails if running.
+    bool setProductInfo(const ProductInfo &info);
+    // make the next begin() do a full identification.
+    void invalidateProductInfo()
+        {
+        this->m_fProductInfoValid = false;
+        }
     bool sleep();
     bool isRunning() const
         {
         return this->m_state != State::Uninitialized;
         }
+    bool isContinuous() const
+        {
+        return this->m_state == State::Continuous;
+        }
     enum class State : std::uint8_t
         {
         Uninitialized,
@@ -268,16 +671,104 @@ public:
         Triggered,
         Continuous,
         Sleep,
+        Waking,
         };
 
 protected:
+    struct ProductOps
+        {
+        bool (*pIsExpectedProduct)(std::uint32_t productNumber);
+        void (*pResetProductState)(cSDP &sdp);
+        std::uint32_t (*pGetConversionMaxMs)(const cSDP &sdp);
+        void (*pUpdateConversionEstimate)(cSDP &sdp, std::uint32_t tMeasured);
+        std::uint8_t (*pGetMeasurementLength)(const cSDP &sdp);
+        };
+
+    // the steps for the product described by TTraits.
+    template <typename TTraits> static const ProductOps *getProductOps();
+
+#if defined(ARDUINO)
+    cSDP(TwoWire &wire, Address Address, Pin_t pinAlert, const ProductOps *pProductOps)
+        : m_WireBus(&wire)
+        , m_pBus(&m_WireBus)
+        , m_pClock(&s_ArduinoClock)
+        , m_pProductOps(pProductOps)
+        , m_address(Address)
+        , m_pinAlert(pinAlert)
+        {
+        pProductOps->pResetProductState(*this);
+        }
+#endif
+
+    cSDP(cBus &bus, cClock &clock, Address Address, Pin_t pinAlert, const ProductOps *pProductOps)
+        : m_pBus(&bus)
+        , m_pClock(&clock)
+        , m_pProductOps(pProductOps)
+        , m_address(Address)
+        , m_pinAlert(pinAlert)
+        {
+        pProductOps->pResetProductState(*this);
+        }
+
     bool writeCommand(Command c);
+    void waitStopSettled();
+    static constexpr Command getTriggeredCommand(Mode mode, bool fStretch)
+        {
+        return (mode == Mode::MassFlow)
+                ? (fStretch ? Command::StartTriggeredMassflow_Stretch
+                            : Command::StartTriggeredMassflow_Poll)
+                : (fStretch ? Command::StartTriggeredDifferential_Stretch
+                            : Command::StartTriggeredDifferential_Poll)
+                ;
+        }
+    static constexpr Command getContinuousCommand(Mode mode, Averaging averaging)
+        {
+        return (mode == Mode::MassFlow)
+                ? (averaging == Averaging::Average ? Command::StartContinuousMassFlow_Average
+                                                   : Command::StartContinuousMassFlow_Point)
+                : (averaging == Averaging::Average ? Command::StartContinuousDifferential_Average
+                                                   : Command::StartContinuousDifferential_Point)
+                ;
+        }
+    bool identify();
+    bool verifyProductInfo();
+    void resetProductState()
+        {
+        this->m_pProductOps->pResetProductState(*this);
+        }
     bool readResponse(std::uint8_t *buf, size_t nBuf);
-    static std::uint8_t crc(const std::uint8_t *buf, size_t nBuf, std::uint8_t crc8 = 0xFF);
+    cBus::Status busWrite(const std::uint8_t *pBuf, size_t nBuf);
+    cBus::Status busRead(std::uint8_t *pBuf, size_t nBuf);
+    bool probeMeasurement();
+    bool tryReadMeasurementBuffer();
+    std::uint8_t getMeasurementLength() const
+        {
+        return this->m_pProductOps->pGetMeasurementLength(*this);
+        }
+    void updateConversionEstimate(std::uint32_t tMeasured)
+        {
+        this->m_pProductOps->pUpdateConversionEstimate(*this, tMeasured);
+        }
+    template <typename TTraits> static void resetProductStateT(cSDP &sdp);
+    template <typename TTraits> static void updateConversionEstimateT(cSDP &sdp, std::uint32_t tMeasured);
+    template <typename TTraits> static std::uint8_t getMeasurementLengthT(const cSDP &sdp);
+    static std::uint8_t crc(const std::uint8_t *buf, size_t nBuf, std::uint8_t crc8 = cCrc8::kInit)
+        {
+        return cCrc8::crc(buf, nBuf, crc8);
+        }
     bool crc_multi(const std::uint8_t *buf, size_t nBuf);
     std::int8_t getAddress() const
         { return static_cast<std::int8_t>(this->m_address); }
     bool wakeup();
+    void beginAlert();
+    void endAlert();
+    void clearAlert()
+        {
+        this->m_fAlert = false;
+        }
+    bool checkAlert() const;
+    void alertIsr();
+    template <unsigned kSlot> static void alertIsrSlot();
     bool checkRunning()
         {
         if (! this->isRunning())
@@ -288,17 +779,88 @@ protected:
 
 // following are arranged for alignment.
 private:
-    Measurement m_Measurement;      /// most recent measurement
-    TwoWire *m_wire;                /// pointer to bus to be used for this device
+#if defined(ARDUINO)
+    cWireBus m_WireBus;             /// bus wrapper, if constructed with a TwoWire
+#endif
+    cBus *m_pBus;                   /// pointer to bus to be used for this device
+    cClock *m_pClock;               /// pointer to time source
+    const ProductOps *m_pProductOps; /// product-dependent steps
     std::uint32_t m_tReady;         /// time next measurement will be ready (millis)
-    ProductInfo m_ProductInfo;      /// product information read from device
-    MeasurementRaw m_MeasurementRaw; /// most recent raw data
+    std::uint32_t m_tStart;         /// time triggered measurement was started (millis)
+    std::uint32_t m_tWakeup;        /// time of next wakeup attempt (millis)
+    std::uint32_t m_tStop;          /// time of last stop command (millis)
+    std::uint16_t m_convEstimate16  /// estimated conversion time (ms * 16)
+        { kTriggeredConversionMs * 16 };
+    std::uint8_t m_measurementBuffer[3 * 3]; /// data fetched by a successful probe
+    std::uint8_t m_nMeasurementBuffer; /// number of bytes in m_measurementBuffer
+    bool m_fMeasurementBuffered     /// true if m_measurementBuffer holds the result
+        { false };
+    bool m_fScaleValid              /// true if m_MeasurementRaw.ScaleBits is cached
+        { false };
+    bool m_fStopSettling            /// true if the sensor may still be ignoring commands after a stop
+        { false };
+    ReadProfile m_readProfile       /// which fields to read
+        { ReadProfile::Full };
+    Mode m_mode                     /// temperature compensation mode
+        { Mode::DifferentialPressure };
+    std::uint8_t m_nTemperatureInterval /// temperature refresh interval for DiffPressure
+        { 0 };
+    std::uint8_t m_nSinceTemperature    /// samples since temperature last read
+        { 0 };
+    ProductInfo m_ProductInfo       /// product information read from device
+        { };
+    bool m_fProductInfoValid        /// true if m_ProductInfo has been read
+        { false };
+    bool m_fProductInfoChecked      /// true if the sensor was identified since begin()
+        { false };
+    MeasurementRaw m_MeasurementRaw /// most recent raw data
+        { };
+    SampleRing_t m_SampleRing;      /// samples collected in continuous mode
+    const cSDPCalibration *m_pCalibration   /// DP corrections, or nullptr
+        { nullptr };
+    AlertCallback_t *m_pAlertCallback   /// called from ISR on alert
+        { nullptr };
+    void *m_pAlertClientData        /// context for m_pAlertCallback
+        { nullptr };
     Address m_address;              /// I2C address to be used
     Pin_t m_pinAlert;               /// alert pin, or -1 if none.
+    std::int8_t m_alertSlot         /// index in s_pAlertInstance, or -1
+        { -1 };
+    volatile bool m_fAlert          /// set by ISR when alert pin asserts
+        { false };
     Error m_lastError;              /// last error.
+#if MCCI_CATENA_SDP_METRICS
+    Metrics m_Metrics               /// telemetry counters
+        { 0, 0, 0, 0, 0, 0, 0, 0, UINT16_MAX, 0, { } };
+#endif
+    std::int8_t m_crcErrorWord      /// index of word that failed CRC, or -1
+        { -1 };
     State m_state                   /// current state
         { State::Uninitialized };   // initially not yet started.
 
+    static cSDP *s_pAlertInstance[kMaxAlertInstances];
+#if defined(ARDUINO)
+    static cArduinoClock s_ArduinoClock;
+#endif
+
+    std::uint32_t millis() const
+        {
+        return this->m_pClock->millis();
+        }
+    bool setBusError(cBus::Status status);
+
+    // telemetry; these compile to nothing if metrics are disabled.
+#if MCCI_CATENA_SDP_METRICS
+    void countMetric(std::uint32_t Metrics::*pCounter, std::uint32_t n = 1)
+        {
+        this->m_Metrics.*pCounter += n;
+        }
+    void recordLatency(std::uint32_t ms);
+#else
+    void countMetric(std::uint32_t Metrics::*, std::uint32_t = 1) {}
+    void recordLatency(std::uint32_t) {}
+#endif
+
     static constexpr std::uint16_t getUint16BE(const std::uint8_t *p)
         {
         return (p[0] << 8) + p[1];
@@ -309,6 +871,94 @@ private:
         }
    };
 
+// the traits of a cSDP constructed directly: the product isn't known
+// until the sensor is identified. See cSDPProductTraits<> for a product
+// known at compile time.
+struct cSDPGenericTraits
+    {
+    static constexpr bool kFixed = false;
+    static constexpr std::uint16_t kScale = 0;
+
+    static constexpr bool isExpectedProduct(std::uint32_t)
+        {
+        return true;
+        }
+    static std::uint32_t getConversionMaxMs(const cSDP &sdp)
+        {
+        return cSDP::getTriggeredConversionMaxMs(sdp.getProductFamily());
+        }
+    };
+
+template <typename TTraits>
+const cSDP::ProductOps *cSDP::getProductOps()
+    {
+    static const ProductOps ops =
+        {
+        &TTraits::isExpectedProduct,
+        &resetProductStateT<TTraits>,
+        &TTraits::getConversionMaxMs,
+        &updateConversionEstimateT<TTraits>,
+        &getMeasurementLengthT<TTraits>,
+        };
+
+    return &ops;
+    }
+
+// forget product-dependent state: the conversion time estimate and the
+// cached scale factor.
+template <typename TTraits>
+void cSDP::resetProductStateT(cSDP &sdp)
+    {
+    // start learning from the worst case for this product.
+    sdp.m_convEstimate16 = std::uint16_t(TTraits::getConversionMaxMs(sdp) * 16);
+
+    // the first measurement reads and caches the scale, unless it's known
+    // in advance.
+    sdp.m_fScaleValid = TTraits::kFixed;
+    sdp.m_MeasurementRaw.ScaleBits = TTraits::kScale;
+    }
+
+// update the running estimate of conversion time, using an exponentially
+// weighted moving average with weight 1/8. The estimate is kept in 1/16 ms
+// units, and never exceeds the worst case.
+template <typename TTraits>
+void cSDP::updateConversionEstimateT(cSDP &sdp, std::uint32_t tMeasured)
+    {
+    const std::int32_t tMax16 = std::int32_t(TTraits::getConversionMaxMs(sdp) * 16);
+    std::int32_t tMeasured16 = std::int32_t(tMeasured * 16);
+    std::int32_t est16 = sdp.m_convEstimate16;
+
+    if (tMeasured16 > tMax16)
+        tMeasured16 = tMax16;
+
+    est16 += (tMeasured16 - est16) / 8;
+    if (est16 > tMax16)
+        est16 = tMax16;
+
+    sdp.m_convEstimate16 = std::uint16_t(est16);
+    }
+
+// choose how many bytes to read for the next measurement. The scale factor
+// is fixed for a given product, so it's read once and then cached (or, for
+// a product known in advance, never read); the temperature is read as
+// needed by the profile.
+template <typename TTraits>
+std::uint8_t cSDP::getMeasurementLengthT(const cSDP &sdp)
+    {
+    if ((! TTraits::kFixed && ! sdp.m_fScaleValid) || sdp.m_readProfile == ReadProfile::Full)
+        return 3 * 3;
+
+    if (sdp.m_readProfile == ReadProfile::DiffPressureAndTemperature)
+        return 2 * 3;
+
+    // DiffPressure: refresh temperature every nth sample, if asked.
+    if (sdp.m_nTemperatureInterval != 0 &&
+        sdp.m_nSinceTemperature + 1u >= sdp.m_nTemperatureInterval)
+        return 2 * 3;
+
+    return 1 * 3;
+    }
+
 } // namespace McciCatenaSdp
 
 #endif // _MCCI_CATENA_SDP_H_
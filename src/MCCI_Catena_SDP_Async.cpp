@@ -0,0 +1,136 @@
+/*
+
+Module: MCCI_Catena_SDP_Async.cpp
+
+Function:
+    Implementation of cSDPAsync, callback-based measurements.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include <MCCI_Catena_SDP_Async.h>
+
+using namespace McciCatenaSdp;
+
+bool cSDPAsync::requestMeasurement(Callback_t *pCallback, void *pClientData, bool fSleep)
+    {
+    if (this->m_nRequests >= kMaxRequests)
+        return false;
+
+    Request &r = this->m_requests[(this->m_iHead + this->m_nRequests) % kMaxRequests];
+
+    r.pCallback = pCallback;
+    r.pClientData = pClientData;
+    r.fSleep = fSleep;
+    ++this->m_nRequests;
+    return true;
+    }
+
+// run the current request as far as it can go without waiting.
+void cSDPAsync::poll()
+    {
+    for (;;)
+        {
+        switch (this->m_state)
+            {
+        case State::Idle:
+            if (this->m_nRequests == 0)
+                return;
+            this->m_state = State::Begin;
+            break;
+
+        // begin() returns at once if the sensor is already started; it
+        // finishes a start that was waiting for wakeup.
+        case State::Begin:
+            if (this->m_sdp.begin())
+                this->m_state = State::Trigger;
+            else if (this->m_sdp.getLastError() == cSDP::Error::WakeupPending)
+                return;
+            else
+                {
+                this->complete(false);
+                return;
+                }
+            break;
+
+        case State::Trigger:
+            if (this->m_sdp.startTriggeredMeasurement())
+                this->m_state = State::Wait;
+            else if (this->m_sdp.getLastError() == cSDP::Error::WakeupPending)
+                return;
+            else
+                {
+                this->complete(false);
+                return;
+                }
+            break;
+
+        // queryReady() only compares times until the conversion should be
+        // done, so polling here is cheap.
+        case State::Wait:
+            if (this->m_sdp.queryReady())
+                this->m_state = State::Read;
+            else if (this->m_sdp.getLastError() == cSDP::Error::Busy)
+                return;
+            else
+                {
+                this->complete(false);
+                return;
+                }
+            break;
+
+        case State::Read:
+            this->complete(this->m_sdp.readMeasurement());
+            return;
+
+        default:
+            this->m_state = State::Idle;
+            return;
+            }
+        }
+    }
+
+// finish the current request: sleep if asked and nothing else is waiting,
+// then dequeue it and call its callback. The callback may queue another
+// request.
+void cSDPAsync::complete(bool fSuccess)
+    {
+    const Request r = this->m_requests[this->m_iHead];
+    const cSDP::Error error = this->m_sdp.getLastError();
+
+    this->m_iHead = std::uint8_t((this->m_iHead + 1) % kMaxRequests);
+    --this->m_nRequests;
+    this->m_state = State::Idle;
+
+    if (r.fSleep && this->m_nRequests == 0 && this->m_sdp.isRunning())
+        {
+        this->m_sdp.sleep();
+        // report the measurement's outcome, not the sleep's.
+        this->m_sdp.setLastError(error);
+        }
+
+    if (r.pCallback != nullptr)
+        (*r.pCallback)(r.pClientData, this->m_sdp, fSuccess);
+    }
+
+void cSDPAsync::cancel()
+    {
+    // the sensor won't take commands until the conversion is read out.
+    if (this->m_state == State::Wait || this->m_state == State::Read)
+        this->m_sdp.readMeasurement();
+
+    this->m_state = State::Idle;
+    this->m_iHead = 0;
+    this->m_nRequests = 0;
+    }
@@ -0,0 +1,107 @@
+/*
+
+Module: MCCI_Catena_SDP_Async.h
+
+Function:
+    cSDPAsync: callback-based measurements for the Catena SDP library.
+
+Copyright and License:
+    See accompanying LICENSE file.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _MCCI_CATENA_SDP_ASYNC_H_
+# define _MCCI_CATENA_SDP_ASYNC_H_
+# pragma once
+
+#include <MCCI_Catena_SDP.h>
+
+namespace McciCatenaSdp {
+
+// run triggered measurements on one sensor without blocking. Each request
+// is carried through begin/wake, trigger, wait and read (and, optionally,
+// sleep) by successive calls to poll(); when it finishes, the request's
+// callback is called (from poll()) with the outcome.
+class cSDPAsync
+    {
+public:
+    // maximum number of requests that can be queued.
+    static constexpr unsigned kMaxRequests = 4;
+
+    // the completion callback. If fSuccess, the results are available
+    // from sdp in the usual way; otherwise sdp.getLastError() says why.
+    using Callback_t = void (void *pClientData, cSDP &sdp, bool fSuccess);
+
+    cSDPAsync(cSDP &sdp)
+        : m_sdp(sdp)
+        {}
+
+    // neither copyable nor movable
+    cSDPAsync(const cSDPAsync&) = delete;
+    cSDPAsync& operator=(const cSDPAsync&) = delete;
+    cSDPAsync(const cSDPAsync&&) = delete;
+    cSDPAsync& operator=(const cSDPAsync&&) = delete;
+
+    // the steps of a request.
+    enum class State : std::uint8_t
+        {
+        Idle,           // no request in progress
+        Begin,          // starting (or waking) the sensor
+        Trigger,        // sending the trigger command
+        Wait,           // waiting for the conversion
+        Read,           // reading the results
+        };
+
+    // queue a measurement. If fSleep, the sensor is put to sleep after
+    // the measurement if no other request is waiting. Returns false if
+    // the queue is full. Work starts on the next poll().
+    bool requestMeasurement(Callback_t *pCallback, void *pClientData, bool fSleep = false);
+
+    // advance the current request; call often (for example, from the
+    // application's poll loop) while isIdle() is false.
+    void poll();
+
+    // abandon all requests without calling their callbacks. If a
+    // measurement is in progress, its result is discarded.
+    void cancel();
+
+    bool isIdle() const
+        {
+        return this->m_state == State::Idle && this->m_nRequests == 0;
+        }
+    State getState() const
+        {
+        return this->m_state;
+        }
+    unsigned getPendingCount() const
+        {
+        return this->m_nRequests;
+        }
+    cSDP &getSensor() const
+        {
+        return this->m_sdp;
+        }
+
+private:
+    struct Request
+        {
+        Callback_t *pCallback;
+        void *pClientData;
+        bool fSleep;
+        };
+
+    void complete(bool fSuccess);
+
+    cSDP &m_sdp;                            /// the sensor
+    Request m_requests[kMaxRequests];       /// queued requests; [m_iHead] is current
+    std::uint8_t m_iHead = 0;               /// index of the oldest request
+    std::uint8_t m_nRequests = 0;           /// number of queued requests
+    State m_state = State::Idle;            /// progress of current request
+    };
+
+} // namespace McciCatenaSdp
+
+#endif // _MCCI_CATENA_SDP_ASYNC_H_
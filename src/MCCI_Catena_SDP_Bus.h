@@ -0,0 +1,163 @@
+/*
+
+Module: MCCI_Catena_SDP_Bus.h
+
+Function:
+    Bus and clock abstractions used by the Catena SDP library.
+
+Copyright and License:
+    See accompanying LICENSE file.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _MCCI_CATENA_SDP_BUS_H_
+# define _MCCI_CATENA_SDP_BUS_H_
+# pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(ARDUINO)
+# include <Arduino.h>
+# include <Wire.h>
+#endif
+
+namespace McciCatenaSdp {
+
+// the I2C transport used by the driver. On Arduino, cWireBus wraps a
+// TwoWire; host builds supply a simulated bus.
+class cBus
+    {
+public:
+    enum class Status : std::uint8_t
+        {
+        Success = 0,
+        WriteBufferFailed,  // couldn't queue the bytes to write
+        WriteNack,          // address or data was NACKed
+        ReadRequest,        // the read was NACKed or returned too few bytes
+        ReadLong,           // more bytes were received than requested
+        ReadShort,          // fewer bytes were available than reported
+        };
+
+    // prepare the bus for use.
+    virtual void begin() = 0;
+
+    // write nBuf bytes to the device at addr. nBuf may be zero, in which
+    // case only the address is sent (this is used to wake the device).
+    virtual Status write(std::uint8_t addr, const std::uint8_t *pBuf, std::size_t nBuf) = 0;
+
+    // read exactly nBuf bytes from the device at addr.
+    virtual Status read(std::uint8_t addr, std::uint8_t *pBuf, std::size_t nBuf) = 0;
+
+    // return a value identifying the underlying bus, so that different
+    // cBus objects for the same hardware can be recognized.
+    virtual const void *getBusId() const
+        {
+        return this;
+        }
+    };
+
+// the time source used by the driver.
+class cClock
+    {
+public:
+    // return a free-running millisecond counter.
+    virtual std::uint32_t millis() = 0;
+
+    // wait for the specified number of milliseconds.
+    virtual void delay(std::uint32_t ms) = 0;
+    };
+
+#if defined(ARDUINO)
+
+// the bus, implemented with TwoWire.
+class cWireBus : public cBus
+    {
+public:
+    cWireBus(TwoWire *pWire = nullptr)
+        : m_pWire(pWire)
+        {}
+
+    virtual void begin() override
+        {
+        this->m_pWire->begin();
+        }
+
+    virtual Status write(std::uint8_t addr, const std::uint8_t *pBuf, std::size_t nBuf) override
+        {
+        this->m_pWire->beginTransmission(addr);
+        if (nBuf != 0 && this->m_pWire->write(pBuf, nBuf) != nBuf)
+            return Status::WriteBufferFailed;
+        if (this->m_pWire->endTransmission() != 0)
+            return Status::WriteNack;
+        return Status::Success;
+        }
+
+    virtual Status read(std::uint8_t addr, std::uint8_t *pBuf, std::size_t nBuf) override
+        {
+        if (this->m_pWire->requestFrom(addr, std::uint8_t(nBuf)) != nBuf)
+            {
+            this->drain();
+            return Status::ReadRequest;
+            }
+
+        const unsigned nResult = this->m_pWire->available();
+        if (nResult > nBuf)
+            {
+            this->drain();
+            return Status::ReadLong;
+            }
+
+        for (unsigned i = 0; i < nResult; ++i)
+            pBuf[i] = this->m_pWire->read();
+
+        if (nResult != nBuf)
+            return Status::ReadShort;
+
+        return Status::Success;
+        }
+
+    virtual const void *getBusId() const override
+        {
+        return this->m_pWire;
+        }
+
+    TwoWire *getWire() const
+        {
+        return this->m_pWire;
+        }
+
+private:
+    // discard anything partially received.
+    void drain()
+        {
+        while (this->m_pWire->available() > 0)
+            (void) this->m_pWire->read();
+        }
+
+    TwoWire *m_pWire;
+    };
+
+// the clock, implemented with the Arduino millis().
+class cArduinoClock : public cClock
+    {
+public:
+    virtual std::uint32_t millis() override
+        {
+        return ::millis();
+        }
+
+    virtual void delay(std::uint32_t ms) override
+        {
+        ::delay(ms);
+        }
+    };
+
+#endif // defined(ARDUINO)
+
+} // namespace McciCatenaSdp
+
+#endif // _MCCI_CATENA_SDP_BUS_H_
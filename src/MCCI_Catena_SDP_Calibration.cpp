@@ -0,0 +1,244 @@
+/*
+
+Module: MCCI_Catena_SDP_Calibration.cpp
+
+Function:
+    Implementation of cSDPCalibration.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include <MCCI_Catena_SDP_Calibration.h>
+
+using namespace McciCatenaSdp;
+
+// num / den, rounded half away from zero; den must be positive.
+static std::int64_t divRound(std::int64_t num, std::int64_t den)
+    {
+    return (num >= 0) ? (num + den / 2) / den : (num - den / 2) / den;
+    }
+
+const cSDPCalibration::Coefficients *cSDPCalibration::find(std::uint64_t serialNumber) const
+    {
+    for (unsigned i = 0; i < this->m_nEntries; ++i)
+        {
+        if (this->m_entries[i].SerialNumber == serialNumber)
+            return &this->m_entries[i];
+        }
+
+    return nullptr;
+    }
+
+bool cSDPCalibration::setCoefficients(const Coefficients &c)
+    {
+    auto const p = this->find(c.SerialNumber);
+
+    if (p != nullptr)
+        {
+        this->m_entries[p - this->m_entries] = c;
+        return true;
+        }
+
+    if (this->m_nEntries >= kMaxEntries)
+        return false;
+
+    this->m_entries[this->m_nEntries++] = c;
+    return true;
+    }
+
+bool cSDPCalibration::getCoefficients(std::uint64_t serialNumber, Coefficients &c) const
+    {
+    auto const p = this->find(serialNumber);
+
+    if (p == nullptr)
+        return false;
+
+    c = *p;
+    return true;
+    }
+
+bool cSDPCalibration::remove(std::uint64_t serialNumber)
+    {
+    auto const p = this->find(serialNumber);
+
+    if (p == nullptr)
+        return false;
+
+    for (unsigned i = unsigned(p - this->m_entries) + 1; i < this->m_nEntries; ++i)
+        this->m_entries[i - 1] = this->m_entries[i];
+
+    --this->m_nEntries;
+    return true;
+    }
+
+std::int32_t cSDPCalibration::getOffsetMilliPa(const Coefficients &c, std::int32_t temperatureMilliC)
+    {
+    const std::int64_t dT = std::int64_t(temperatureMilliC) - c.RefTempMilliC;
+
+    return std::int32_t(c.OffsetMilliPa + divRound(c.TempCoQ16 * dT, std::int64_t(1000) << 16));
+    }
+
+bool cSDPCalibration::getOffsetMilliPa(std::uint64_t serialNumber, std::int32_t temperatureMilliC, std::int32_t &offset) const
+    {
+    auto const p = this->find(serialNumber);
+
+    if (p == nullptr)
+        return false;
+
+    offset = getOffsetMilliPa(*p, temperatureMilliC);
+    return true;
+    }
+
+bool cSDPCalibration::apply(std::uint64_t serialNumber, cSDP::MeasurementFixed &m) const
+    {
+    std::int32_t offset;
+
+    if (! this->getOffsetMilliPa(serialNumber, m.TemperatureMilliC, offset))
+        return false;
+
+    m.DifferentialPressureMilliPa -= offset;
+    return true;
+    }
+
+bool cSDPCalibration::autoZero(cSDP &sdp, unsigned nSamples, bool fTempCo, Coefficients &result) const
+    {
+    if (nSamples == 0)
+        nSamples = 1;
+    else if (nSamples > kMaxAutoZeroSamples)
+        nSamples = kMaxAutoZeroSamples;
+
+    // measure without correction.
+    auto const pSaved = sdp.getCalibration();
+    std::int64_t sumDp = 0;
+    std::int64_t sumT = 0;
+    bool fResult = true;
+
+    sdp.setCalibration(nullptr);
+    for (unsigned i = 0; i < nSamples; ++i)
+        {
+        if (! sdp.measureBlocking())
+            {
+            fResult = false;
+            break;
+            }
+
+        auto const m = sdp.getMeasurementFixed();
+        sumDp += m.DifferentialPressureMilliPa;
+        sumT += m.TemperatureMilliC;
+        }
+    sdp.setCalibration(pSaved);
+
+    if (! fResult)
+        return false;
+
+    const std::int32_t offset = std::int32_t(divRound(sumDp, nSamples));
+    const std::int32_t t = std::int32_t(divRound(sumT, nSamples));
+    const std::uint64_t serialNumber = sdp.getSerialNumber();
+    Coefficients c;
+
+    if (! this->getCoefficients(serialNumber, c))
+        {
+        c.SerialNumber = serialNumber;
+        c.TempCoQ16 = 0;
+        }
+    else if (fTempCo)
+        {
+        const std::int64_t dT = std::int64_t(t) - c.RefTempMilliC;
+
+        // mPa per deg C, Q16, from the old point and the new one.
+        if (dT >= kMinTempCoSpanMilliC || dT <= -kMinTempCoSpanMilliC)
+            c.TempCoQ16 = std::int32_t(divRound((std::int64_t(offset) - c.OffsetMilliPa) * 1000 * 65536, dT));
+        }
+
+    c.OffsetMilliPa = offset;
+    c.RefTempMilliC = t;
+    result = c;
+    return true;
+    }
+
+/****************************************************************************\
+|
+|   Serialization: all fields big-endian.
+|
+\****************************************************************************/
+
+static std::uint8_t *putBE(std::uint8_t *p, std::uint64_t v, unsigned nBytes)
+    {
+    for (unsigned i = nBytes; i > 0; --i)
+        *p++ = std::uint8_t(v >> (8 * (i - 1)));
+    return p;
+    }
+
+static std::uint64_t getBE(const std::uint8_t *&p, unsigned nBytes)
+    {
+    std::uint64_t v = 0;
+
+    for (unsigned i = 0; i < nBytes; ++i)
+        v = (v << 8) | *p++;
+    return v;
+    }
+
+size_t cSDPCalibration::serialize(std::uint8_t *pBuf, size_t nBuf) const
+    {
+    const size_t nSize = getSerializedSize(this->m_nEntries);
+
+    if (pBuf == nullptr || nBuf < nSize)
+        return 0;
+
+    std::uint8_t *p = pBuf;
+
+    *p++ = kSerialVersion;
+    *p++ = this->m_nEntries;
+    for (unsigned i = 0; i < this->m_nEntries; ++i)
+        {
+        auto const &c = this->m_entries[i];
+
+        p = putBE(p, c.SerialNumber, 8);
+        p = putBE(p, std::uint32_t(c.OffsetMilliPa), 4);
+        p = putBE(p, std::uint32_t(c.TempCoQ16), 4);
+        p = putBE(p, std::uint32_t(c.RefTempMilliC), 4);
+        }
+    *p = cCrc8::crc(pBuf, nSize - 1);
+
+    return nSize;
+    }
+
+bool cSDPCalibration::deserialize(const std::uint8_t *pBuf, size_t nBuf)
+    {
+    if (pBuf == nullptr || nBuf < getSerializedSize(0))
+        return false;
+    if (pBuf[0] != kSerialVersion || pBuf[1] > kMaxEntries)
+        return false;
+
+    const unsigned nEntries = pBuf[1];
+    const size_t nSize = getSerializedSize(nEntries);
+
+    if (nBuf < nSize || cCrc8::crc(pBuf, nSize - 1) != pBuf[nSize - 1])
+        return false;
+
+    const std::uint8_t *p = pBuf + 2;
+
+    for (unsigned i = 0; i < nEntries; ++i)
+        {
+        auto &c = this->m_entries[i];
+
+        c.SerialNumber = getBE(p, 8);
+        c.OffsetMilliPa = std::int32_t(std::uint32_t(getBE(p, 4)));
+        c.TempCoQ16 = std::int32_t(std::uint32_t(getBE(p, 4)));
+        c.RefTempMilliC = std::int32_t(std::uint32_t(getBE(p, 4)));
+        }
+    this->m_nEntries = std::uint8_t(nEntries);
+
+    return true;
+    }
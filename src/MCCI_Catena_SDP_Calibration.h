@@ -0,0 +1,130 @@
+/*
+
+Module: MCCI_Catena_SDP_Calibration.h
+
+Function:
+    cSDPCalibration: per-unit zero and temperature-drift correction for
+    the Catena SDP library.
+
+Copyright and License:
+    See accompanying LICENSE file.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _MCCI_CATENA_SDP_CALIBRATION_H_
+# define _MCCI_CATENA_SDP_CALIBRATION_H_
+# pragma once
+
+#include <MCCI_Catena_SDP.h>
+
+namespace McciCatenaSdp {
+
+// a table of zero-offset corrections, one per sensor, keyed by serial
+// number. The offset (the reading with both ports at the same pressure)
+// is modeled as a straight line in temperature:
+//
+//      offset(T) = OffsetMilliPa + TempCoQ16 * (T - RefTempMilliC) / 2^16 / 1000
+//
+// with T in milli-degrees C. Attach the table to a sensor with
+// cSDP::setCalibration(); each reading's DP is then corrected by the
+// offset at the reading's temperature. The correction is applied to the
+// raw DP, in sensor counts, so that every form of the reading (raw,
+// fixed, float, and continuous samples) agrees; it is rounded to the
+// nearest count.
+class cSDPCalibration
+    {
+public:
+    static constexpr unsigned kMaxEntries = 4;
+
+    // auto-zero readings must span at least this much temperature to
+    // estimate the temperature coefficient.
+    static constexpr std::int32_t kMinTempCoSpanMilliC = 5000;
+
+    // autoZero() blocks for each reading, up to kTriggeredConversionMs
+    // (46 ms); this many readings keeps it under 400 ms.
+    static constexpr unsigned kMaxAutoZeroSamples = 8;
+
+    // the serialized form: version, count, entries, CRC-8.
+    static constexpr std::uint8_t kSerialVersion = 1;
+    static constexpr size_t kSerializedEntrySize = 8 + 4 + 4 + 4;
+    static constexpr size_t getSerializedSize(unsigned nEntries)
+        {
+        return 2 + nEntries * kSerializedEntrySize + 1;
+        }
+    static constexpr size_t kMaxSerializedSize = 2 + kMaxEntries * kSerializedEntrySize + 1;
+
+    struct Coefficients
+        {
+        std::uint64_t SerialNumber;     /// the sensor
+        std::int32_t OffsetMilliPa;     /// offset at RefTempMilliC
+        std::int32_t TempCoQ16;         /// change in offset, mPa per deg C, Q16
+        std::int32_t RefTempMilliC;     /// temperature of OffsetMilliPa
+        };
+
+    cSDPCalibration() {}
+
+    // neither copyable nor movable
+    cSDPCalibration(const cSDPCalibration&) = delete;
+    cSDPCalibration& operator=(const cSDPCalibration&) = delete;
+    cSDPCalibration(const cSDPCalibration&&) = delete;
+    cSDPCalibration& operator=(const cSDPCalibration&&) = delete;
+
+    // add or replace the entry for c.SerialNumber. Returns false if the
+    // table is full.
+    bool setCoefficients(const Coefficients &c);
+    // get the entry for a sensor; false if there is none.
+    bool getCoefficients(std::uint64_t serialNumber, Coefficients &c) const;
+    bool remove(std::uint64_t serialNumber);
+    void clear()
+        {
+        this->m_nEntries = 0;
+        }
+    unsigned getCount() const
+        {
+        return this->m_nEntries;
+        }
+
+    // the offset for a sensor at a given temperature.
+    static std::int32_t getOffsetMilliPa(const Coefficients &c, std::int32_t temperatureMilliC);
+    // the same, for the sensor with the given serial number; false if
+    // there's no entry.
+    bool getOffsetMilliPa(std::uint64_t serialNumber, std::int32_t temperatureMilliC, std::int32_t &offset) const;
+
+    // correct a reading from the sensor with the given serial number, by
+    // subtracting the offset at the reading's temperature from its DP.
+    // Returns false (leaving m unchanged) if there's no entry.
+    bool apply(std::uint64_t serialNumber, cSDP::MeasurementFixed &m) const;
+
+    // measure the offset of a sensor whose ports are equalized, by
+    // averaging nSamples triggered measurements, without correction. The
+    // result is based on the sensor's current entry, if any: the offset
+    // and reference temperature are replaced; if fTempCo, and the
+    // temperature now differs from the entry's reference temperature by at
+    // least kMinTempCoSpanMilliC, the temperature coefficient is set from
+    // the two points. Store the result with setCoefficients(). Returns
+    // false if a measurement fails (see sdp.getLastError()). nSamples is
+    // limited to kMaxAutoZeroSamples, because the readings are made with
+    // measureBlocking(), and nothing else runs meanwhile.
+    bool autoZero(cSDP &sdp, unsigned nSamples, bool fTempCo, Coefficients &result) const;
+
+    // save the table to a buffer of at least getSerializedSize(getCount())
+    // bytes; returns the number of bytes used, or 0 if nBuf is too small.
+    size_t serialize(std::uint8_t *pBuf, size_t nBuf) const;
+    // restore the table from serialize()'s output; returns false, leaving
+    // the table unchanged, if the data is not valid.
+    bool deserialize(const std::uint8_t *pBuf, size_t nBuf);
+
+private:
+    const Coefficients *find(std::uint64_t serialNumber) const;
+
+    Coefficients m_entries[kMaxEntries];    /// the table
+    std::uint8_t m_nEntries                 /// number of entries in use
+        { 0 };
+    };
+
+} // namespace McciCatenaSdp
+
+#endif // _MCCI_CATENA_SDP_CALIBRATION_H_
@@ -0,0 +1,105 @@
+/*
+
+Module: MCCI_Catena_SDP_Crc.cpp
+
+Function:
+    CRC-8 engines for the Catena SDP library.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include <MCCI_Catena_SDP_Crc.h>
+
+using namespace McciCatenaSdp;
+
+/****************************************************************************\
+|
+|   The tables. The 256-entry tables are generated by the compiler from
+|   the constexpr functions in the header, so they are constant-initialized
+|   and end up in flash.
+|
+\****************************************************************************/
+
+#define SDP_CRC_ROW(f, r)                                               \
+    f(r + 0x0), f(r + 0x1), f(r + 0x2), f(r + 0x3),                     \
+    f(r + 0x4), f(r + 0x5), f(r + 0x6), f(r + 0x7),                     \
+    f(r + 0x8), f(r + 0x9), f(r + 0xA), f(r + 0xB),                     \
+    f(r + 0xC), f(r + 0xD), f(r + 0xE), f(r + 0xF)
+
+#define SDP_CRC_TABLE(f)                                                \
+    SDP_CRC_ROW(f, 0x00), SDP_CRC_ROW(f, 0x10),                         \
+    SDP_CRC_ROW(f, 0x20), SDP_CRC_ROW(f, 0x30),                         \
+    SDP_CRC_ROW(f, 0x40), SDP_CRC_ROW(f, 0x50),                         \
+    SDP_CRC_ROW(f, 0x60), SDP_CRC_ROW(f, 0x70),                         \
+    SDP_CRC_ROW(f, 0x80), SDP_CRC_ROW(f, 0x90),                         \
+    SDP_CRC_ROW(f, 0xA0), SDP_CRC_ROW(f, 0xB0),                         \
+    SDP_CRC_ROW(f, 0xC0), SDP_CRC_ROW(f, 0xD0),                         \
+    SDP_CRC_ROW(f, 0xE0), SDP_CRC_ROW(f, 0xF0)
+
+/* see cSHT3x CRC-8-Calc.md for a little info on this */
+const std::uint8_t cCrc8::s_nibbleTable[16] =
+    {
+    0x00, 0x31, 0x62, 0x53, 0xc4, 0xf5, 0xa6, 0x97,
+    0xb9, 0x88, 0xdb, 0xea, 0x7d, 0x4c, 0x1f, 0x2e,
+    };
+
+const std::uint8_t cCrc8::s_byteTable[256] =
+    {
+    SDP_CRC_TABLE(cCrc8::byteTableEntry)
+    };
+
+const std::uint8_t cCrc8::s_wordTable[256] =
+    {
+    SDP_CRC_TABLE(cCrc8::wordTableEntry)
+    };
+
+#undef SDP_CRC_TABLE
+#undef SDP_CRC_ROW
+
+/****************************************************************************\
+|
+|   The engines
+|
+\****************************************************************************/
+
+std::uint8_t cCrc8::crcNibble(const std::uint8_t * buf, std::size_t nBuf, std::uint8_t crc8)
+    {
+    for (std::size_t i = nBuf; i > 0; --i, ++buf)
+        {
+        std::uint8_t b, p;
+
+        // calculate first nibble
+        b = *buf;
+        p = (b ^ crc8) >> 4;
+        crc8 = (crc8 << 4) ^ s_nibbleTable[p];
+
+        // calculate second nibble
+        // this could be written as:
+        //      b <<= 4;
+        //      p = (b ^ crc8) >> 4;
+        // but it's more effective as:
+        p = ((crc8 >> 4) ^ b) & 0xF;
+        crc8 = (crc8 << 4) ^ s_nibbleTable[p];
+        }
+
+    return crc8;
+    }
+
+std::uint8_t cCrc8::crcByte(const std::uint8_t * buf, std::size_t nBuf, std::uint8_t crc8)
+    {
+    for (std::size_t i = nBuf; i > 0; --i, ++buf)
+        crc8 = s_byteTable[crc8 ^ *buf];
+
+    return crc8;
+    }
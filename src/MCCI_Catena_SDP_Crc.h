@@ -0,0 +1,127 @@
+/*
+
+Module: MCCI_Catena_SDP_Crc.h
+
+Function:
+    CRC-8 engines for validating SDP data words.
+
+Copyright and License:
+    See accompanying LICENSE file.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _MCCI_CATENA_SDP_CRC_H_
+# define _MCCI_CATENA_SDP_CRC_H_
+# pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// \brief select the CRC engine used by the driver.
+///
+/// \details
+///     0 selects the 16-entry nibble table (two lookups per byte, 16 bytes
+///     of table); 1 selects the 256-entry byte table (one lookup per byte,
+///     256 bytes of table); 2 selects the word engine, which computes the
+///     CRC of a 2-byte SDP word with two independent lookups (512 bytes of
+///     table). All three give identical results.
+///
+#ifndef MCCI_CATENA_SDP_CRC_ENGINE
+# define MCCI_CATENA_SDP_CRC_ENGINE 1
+#endif
+
+#if MCCI_CATENA_SDP_CRC_ENGINE < 0 || MCCI_CATENA_SDP_CRC_ENGINE > 2
+# error "MCCI_CATENA_SDP_CRC_ENGINE must be 0, 1 or 2"
+#endif
+
+namespace McciCatenaSdp {
+
+// CRC-8 as used by Sensirion: polynomial 0x31, initial value 0xFF,
+// no reflection, no final XOR. Each 16-bit data word on the wire is
+// followed by the CRC of its two bytes.
+class cCrc8
+    {
+public:
+    static constexpr std::uint8_t kPoly = 0x31;
+    static constexpr std::uint8_t kInit = 0xFF;
+    static constexpr std::uint8_t kEngine = MCCI_CATENA_SDP_CRC_ENGINE;
+    static constexpr std::size_t kBytesPerWord = 3;
+    static constexpr std::size_t kBatchSuccess = SIZE_MAX;
+
+    // the individual engines; all are available regardless of kEngine,
+    // so they can be compared.
+    static std::uint8_t crcNibble(const std::uint8_t *buf, std::size_t nBuf, std::uint8_t crc8 = kInit);
+    static std::uint8_t crcByte(const std::uint8_t *buf, std::size_t nBuf, std::uint8_t crc8 = kInit);
+    static std::uint8_t crcWord(std::uint8_t b0, std::uint8_t b1)
+        {
+        return s_wordTable[b0] ^ s_byteTable[b1];
+        }
+
+    // the CRC of a buffer, using the selected engine.
+    static std::uint8_t crc(const std::uint8_t *buf, std::size_t nBuf, std::uint8_t crc8 = kInit)
+        {
+#if MCCI_CATENA_SDP_CRC_ENGINE == 0
+        return crcNibble(buf, nBuf, crc8);
+#else
+        return crcByte(buf, nBuf, crc8);
+#endif
+        }
+
+    // the CRC of one data word, using the selected engine.
+    static std::uint8_t crcDataWord(const std::uint8_t *pWord)
+        {
+#if MCCI_CATENA_SDP_CRC_ENGINE == 2
+        return crcWord(pWord[0], pWord[1]);
+#else
+        return crc(pWord, 2);
+#endif
+        }
+
+    // check a burst of nWords 3-byte words in one pass. Returns
+    // kBatchSuccess if all words are good, otherwise the index of
+    // the first bad word.
+    static std::size_t validateBurst(const std::uint8_t *buf, std::size_t nWords)
+        {
+        for (std::size_t i = 0; i < nWords; ++i, buf += kBytesPerWord)
+            {
+            if (crcDataWord(buf) != buf[2])
+                return i;
+            }
+        return kBatchSuccess;
+        }
+
+    // compile-time table generation. The entries of the byte table are the
+    // CRC of a single byte with an initial value of zero; since the CRC is
+    // linear, the CRC of (b0, b1) from kInit is
+    // byteTable[byteTable[b0 ^ kInit]] ^ byteTable[b1], so the word table
+    // holds the first term.
+    static constexpr std::uint8_t shiftBits(std::uint8_t c, unsigned nBits)
+        {
+        return nBits == 0 ? c
+                          : shiftBits(
+                                (c & 0x80) ? std::uint8_t((c << 1) ^ kPoly)
+                                           : std::uint8_t(c << 1),
+                                nBits - 1
+                                );
+        }
+    static constexpr std::uint8_t byteTableEntry(std::uint8_t i)
+        {
+        return shiftBits(i, 8);
+        }
+    static constexpr std::uint8_t wordTableEntry(std::uint8_t i)
+        {
+        return byteTableEntry(byteTableEntry(std::uint8_t(i ^ kInit)));
+        }
+
+private:
+    static const std::uint8_t s_nibbleTable[16];
+    static const std::uint8_t s_byteTable[256];
+    static const std::uint8_t s_wordTable[256];
+    };
+
+} // namespace McciCatenaSdp
+
+#endif // _MCCI_CATENA_SDP_CRC_H_
@@ -0,0 +1,130 @@
+/*
+
+Module: MCCI_Catena_SDP_Filter.cpp
+
+Function:
+    Implementation of cSDPFilter, the fixed-point filter chain.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include <MCCI_Catena_SDP_Filter.h>
+
+using namespace McciCatenaSdp;
+
+bool cSDPFilter::configure(const Config &config)
+    {
+    if (config.MedianN > kMaxMedianN ||
+        (config.MedianN > 1 && (config.MedianN & 1) == 0) ||
+        config.EmaShift > kMaxEmaShift)
+        return false;
+
+    this->m_config = config;
+    this->reset();
+    return true;
+    }
+
+void cSDPFilter::reset()
+    {
+    this->m_nWindow = 0;
+    this->m_iOldest = 0;
+    this->m_fEmaValid = false;
+    this->m_decimSum = 0;
+    this->m_nDecim = 0;
+    }
+
+// the window is kept both in arrival order and sorted, so each reading
+// costs one delete and one insert in the sorted copy, rather than a sort.
+// Until the window fills, the median is of the readings so far.
+std::int32_t cSDPFilter::median(std::int32_t v)
+    {
+    const unsigned nMax = this->m_config.MedianN;
+    auto const sorted = this->m_sorted;
+    unsigned n = this->m_nWindow;
+
+    if (n == nMax)
+        {
+        // drop the oldest reading from the sorted copy.
+        const std::int32_t old = this->m_window[this->m_iOldest];
+        unsigned i = 0;
+
+        while (sorted[i] != old)
+            ++i;
+        for (--n; i < n; ++i)
+            sorted[i] = sorted[i + 1];
+
+        this->m_window[this->m_iOldest] = v;
+        this->m_iOldest = std::uint8_t((this->m_iOldest + 1) % nMax);
+        }
+    else
+        {
+        this->m_window[n] = v;
+        }
+
+    unsigned i = n;
+    for (; i > 0 && sorted[i - 1] > v; --i)
+        sorted[i] = sorted[i - 1];
+    sorted[i] = v;
+
+    this->m_nWindow = std::uint8_t(++n);
+    return sorted[n / 2];
+    }
+
+std::int32_t cSDPFilter::ema(std::int32_t v)
+    {
+    const std::int64_t x = std::int64_t(v) * (std::int64_t(1) << kEmaFracBits);
+
+    if (! this->m_fEmaValid)
+        {
+        this->m_emaState = x;
+        this->m_fEmaValid = true;
+        }
+    else
+        {
+        // the arithmetic shift rounds towards minus infinity; the error
+        // is in the fraction bits, well below one unit of the input.
+        this->m_emaState += (x - this->m_emaState) >> this->m_config.EmaShift;
+        }
+
+    return std::int32_t((this->m_emaState + (std::int64_t(1) << (kEmaFracBits - 1))) >> kEmaFracBits);
+    }
+
+bool cSDPFilter::put(std::int32_t v, std::int32_t &out)
+    {
+    if (this->m_config.MedianN > 1)
+        v = this->median(v);
+
+    if (this->m_config.EmaShift > 0)
+        v = this->ema(v);
+
+    const unsigned nDecim = this->m_config.Decimation;
+
+    if (nDecim > 1)
+        {
+        this->m_decimSum += v;
+        if (++this->m_nDecim < nDecim)
+            return false;
+
+        // the mean of the group, rounded half away from zero.
+        const std::int64_t sum = this->m_decimSum;
+        const std::int64_t n = nDecim;
+
+        v = std::int32_t((sum >= 0) ? (sum + n / 2) / n : (sum - n / 2) / n);
+        this->m_decimSum = 0;
+        this->m_nDecim = 0;
+        }
+
+    out = v;
+    return true;
+    }
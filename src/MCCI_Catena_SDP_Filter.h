@@ -0,0 +1,103 @@
+/*
+
+Module: MCCI_Catena_SDP_Filter.h
+
+Function:
+    cSDPFilter: fixed-point filter chain for the Catena SDP library.
+
+Copyright and License:
+    See accompanying LICENSE file.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _MCCI_CATENA_SDP_FILTER_H_
+# define _MCCI_CATENA_SDP_FILTER_H_
+# pragma once
+
+#include <cstdint>
+
+namespace McciCatenaSdp {
+
+// a filter chain for a stream of integer readings (for example, DP in
+// mPa), in integer arithmetic. Each reading passes through up to three
+// stages, in order:
+//
+// - a running median of the last MedianN readings, to reject spikes
+//   (bypassed if MedianN is 0 or 1);
+// - an exponential moving average, y += (x - y) / 2^EmaShift, to smooth
+//   ripple; the state carries kEmaFracBits extra bits so that small steps
+//   aren't lost (bypassed only if EmaShift is 0; 1 is a weight of 1/2);
+// - a decimator, which outputs the mean of each Decimation readings
+//   (bypassed if Decimation is 0 or 1).
+//
+// The chain is configured at runtime; changing the configuration resets
+// it.
+class cSDPFilter
+    {
+public:
+    static constexpr unsigned kMaxMedianN = 7;
+    static constexpr unsigned kMaxEmaShift = 15;
+    static constexpr unsigned kEmaFracBits = 16;
+
+    struct Config
+        {
+        std::uint8_t MedianN;       /// width of median window (odd, up to kMaxMedianN)
+        std::uint8_t EmaShift;      /// EMA weight is 1/2^EmaShift (up to kMaxEmaShift)
+        std::uint8_t Decimation;    /// readings per output
+        };
+
+    cSDPFilter()
+        {
+        this->reset();
+        }
+
+    // neither copyable nor movable
+    cSDPFilter(const cSDPFilter&) = delete;
+    cSDPFilter& operator=(const cSDPFilter&) = delete;
+    cSDPFilter(const cSDPFilter&&) = delete;
+    cSDPFilter& operator=(const cSDPFilter&&) = delete;
+
+    // set the configuration and reset. Returns false, and leaves the
+    // configuration unchanged, if MedianN is even (other than 0) or too
+    // large, or EmaShift is too large.
+    bool configure(const Config &config);
+    const Config &getConfig() const
+        {
+        return this->m_config;
+        }
+
+    // discard the history; the next reading starts the filter afresh.
+    void reset();
+
+    // filter a reading. Returns true and sets out if the chain produced
+    // an output (with decimation, only every Decimation readings).
+    bool put(std::int32_t v, std::int32_t &out);
+
+private:
+    std::int32_t median(std::int32_t v);
+    std::int32_t ema(std::int32_t v);
+
+    Config m_config             /// the configuration
+        { 1, 0, 1 };
+
+    // median stage
+    std::int32_t m_window[kMaxMedianN];     /// last readings, in arrival order (ring)
+    std::int32_t m_sorted[kMaxMedianN];     /// the same readings, sorted
+    std::uint8_t m_nWindow;                 /// number of readings in the window
+    std::uint8_t m_iOldest;                 /// index of the oldest reading in m_window
+
+    // EMA stage
+    std::int64_t m_emaState;    /// the average, with kEmaFracBits fraction bits
+    bool m_fEmaValid;           /// true once the average is started
+
+    // decimator stage
+    std::int64_t m_decimSum;    /// sum of readings in this group
+    std::uint8_t m_nDecim;      /// number of readings in this group
+    };
+
+} // namespace McciCatenaSdp
+
+#endif // _MCCI_CATENA_SDP_FILTER_H_
@@ -0,0 +1,150 @@
+/*
+
+Module: MCCI_Catena_SDP_Flow.cpp
+
+Function:
+    Implementation of cSDPFlow.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include <MCCI_Catena_SDP_Flow.h>
+
+#include <MCCI_Catena_SDP_Stats.h>
+
+using namespace McciCatenaSdp;
+
+// num / den, rounded half away from zero; den must be positive.
+static std::int64_t divRound(std::int64_t num, std::int64_t den)
+    {
+    return (num >= 0) ? (num + den / 2) / den : (num - den / 2) / den;
+    }
+
+static std::int32_t clamp32(std::int64_t v)
+    {
+    return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : std::int32_t(v);
+    }
+
+bool cSDPFlow::configure(const Config &config)
+    {
+    switch (config.element)
+        {
+    case Element::None:
+        break;
+
+    case Element::Pitot:
+    case Element::Orifice:
+        if (config.AreaMm2 == 0 || config.AreaMm2 > kMaxAreaMm2)
+            return false;
+        // fall through
+    case Element::Bypass:
+        if (config.KFactorQ16 == 0 || config.KFactorQ16 > kMaxKFactorQ16)
+            return false;
+        if (config.AmbientPressurePa < kMinAmbientPressurePa ||
+            config.AmbientPressurePa > kMaxAmbientPressurePa)
+            return false;
+        break;
+
+    default:
+        return false;
+        }
+
+    this->m_config = config;
+    return true;
+    }
+
+// density = P / (R T); in mg/m^3, that's P[Pa] * 10^12 / (R[mJ/(kg K)] * T[mK]).
+// With the limits on P and T, the density is 34837 to 6967427 mg/m^3.
+std::uint32_t cSDPFlow::getAirDensity(std::int32_t temperatureMilliC, std::uint32_t pressurePa)
+    {
+    std::int64_t tMilliK = std::int64_t(temperatureMilliC) + 273150;
+
+    if (tMilliK < kMinTemperatureMilliK)
+        tMilliK = kMinTemperatureMilliK;
+    else if (tMilliK > kMaxTemperatureMilliK)
+        tMilliK = kMaxTemperatureMilliK;
+
+    if (pressurePa > kMaxAmbientPressurePa)
+        pressurePa = kMaxAmbientPressurePa;
+
+    return std::uint32_t(divRound(std::int64_t(pressurePa) * 1000000000000, tMilliK * kAirGasConstant));
+    }
+
+// v[um/s]^2 = 2 * DP[mPa] * 10^15 / density[mg/m^3]. The product doesn't
+// fit in 64 bits for large DP, so the division is done in two parts: the
+// quotient and remainder of 2 * DP * 10^9 / density, each scaled by 10^6.
+std::int64_t cSDPFlow::getVelocityMicrons(std::int32_t diffPressureMilliPa, std::uint32_t densityMgPerM3)
+    {
+    if (densityMgPerM3 == 0)
+        return 0;
+
+    if (diffPressureMilliPa > kMaxDiffPressureMilliPa)
+        diffPressureMilliPa = kMaxDiffPressureMilliPa;
+    else if (diffPressureMilliPa < -kMaxDiffPressureMilliPa)
+        diffPressureMilliPa = -kMaxDiffPressureMilliPa;
+
+    const std::uint64_t absDp = diffPressureMilliPa < 0 ? std::uint64_t(-std::int64_t(diffPressureMilliPa))
+                                                        : std::uint64_t(diffPressureMilliPa);
+    const std::uint64_t num = 2 * absDp * 1000000000u;
+    const std::uint64_t q = num / densityMgPerM3;
+    const std::uint64_t r = num % densityMgPerM3;
+    const std::uint64_t v = isqrt64(q * 1000000u + r * 1000000u / densityMgPerM3);
+
+    return diffPressureMilliPa < 0 ? -std::int64_t(v) : std::int64_t(v);
+    }
+
+bool cSDPFlow::compute(std::int32_t diffPressureMilliPa, std::int32_t temperatureMilliC, Flow &flow) const
+    {
+    auto const &config = this->m_config;
+    const std::uint32_t density = getAirDensity(temperatureMilliC, config.AmbientPressurePa);
+    std::int64_t volumeMicroL;
+
+    flow.DensityMgPerM3 = density;
+    flow.VelocityMmPerS = 0;
+
+    switch (config.element)
+        {
+    case Element::Pitot:
+    case Element::Orifice:
+        {
+        // the velocity through the area, times K; A[mm^2] * v[um/s] is
+        // in units of 10^-3 uL/s.
+        const std::int64_t v = divRound(getVelocityMicrons(diffPressureMilliPa, density) * config.KFactorQ16, 65536);
+
+        if (config.element == Element::Pitot)
+            flow.VelocityMmPerS = clamp32(divRound(v, 1000));
+        volumeMicroL = divRound(v * config.AreaMm2, 1000);
+        }
+        break;
+
+    case Element::Bypass:
+        // K[mL/s per Pa] * DP[mPa] is in uL/s.
+        volumeMicroL = divRound(std::int64_t(diffPressureMilliPa) * config.KFactorQ16, 65536);
+        break;
+
+    default:
+        return false;
+        }
+
+    // bounding the volume keeps the product with the density in 64 bits.
+    if (volumeMicroL > kMaxVolumeMicroLPerS)
+        volumeMicroL = kMaxVolumeMicroLPerS;
+    else if (volumeMicroL < -kMaxVolumeMicroLPerS)
+        volumeMicroL = -kMaxVolumeMicroLPerS;
+
+    flow.VolumeMilliLPerS = clamp32(divRound(volumeMicroL, 1000));
+    // mass[mg/s] = density[mg/m^3] * volume[uL/s] / 10^9
+    flow.MassMgPerS = clamp32(divRound(volumeMicroL * density, 1000000000));
+    return true;
+    }
@@ -0,0 +1,123 @@
+/*
+
+Module: MCCI_Catena_SDP_Flow.h
+
+Function:
+    cSDPFlow: flow computation from differential pressure for the Catena
+    SDP library.
+
+Copyright and License:
+    See accompanying LICENSE file.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _MCCI_CATENA_SDP_FLOW_H_
+# define _MCCI_CATENA_SDP_FLOW_H_
+# pragma once
+
+#include <cstdint>
+
+namespace McciCatenaSdp {
+
+// convert DP (and temperature, for the density of air) to flow, in
+// integer arithmetic. The flow element is one of:
+//
+// - Pitot: a pitot-static tube in a duct. The velocity is
+//   K * sqrt(2 * DP / density), and the volume flow is the velocity
+//   times the duct's area.
+// - Orifice: an orifice plate, venturi or other restriction. The volume
+//   flow is K * area * sqrt(2 * DP / density), where K is the discharge
+//   coefficient (including the approach factor), and the area is the
+//   area of the restriction.
+// - Bypass: the sensor in a bypass around a laminar flow element, where
+//   flow is proportional to DP. K is in mL/s per Pa, and the area and
+//   density are not used.
+//
+// The density is computed from the ideal gas law for dry air, using the
+// reading's temperature and a configured ambient (absolute) pressure.
+// Negative DP gives negative (reverse) flow.
+class cSDPFlow
+    {
+public:
+    static constexpr std::uint32_t kStandardPressurePa = 101325;
+    // specific gas constant of dry air, in mJ/(kg K).
+    static constexpr std::uint32_t kAirGasConstant = 287050;
+
+    // the limits of the configuration, and of the inputs. These keep
+    // every intermediate result within 64 bits: the density is clamped
+    // to what these pressures and temperatures give, and |DP| to well
+    // above the range of any SDP.
+    static constexpr std::uint32_t kMinAmbientPressurePa = 10000;
+    static constexpr std::uint32_t kMaxAmbientPressurePa = 200000;
+    static constexpr std::uint32_t kMaxKFactorQ16 = 100u << 16;
+    static constexpr std::uint32_t kMaxAreaMm2 = 10u * 1000 * 1000;       // 10 m^2
+    static constexpr std::int32_t kMinTemperatureMilliK = 100000;         // -173.15 C
+    static constexpr std::int32_t kMaxTemperatureMilliK = 1000000;        // 726.85 C
+    static constexpr std::int32_t kMaxDiffPressureMilliPa = 10 * 1000 * 1000; // 10 kPa
+    // volume flows beyond this (1000 m^3/s) are clamped.
+    static constexpr std::int64_t kMaxVolumeMicroLPerS = 1000000000000;
+
+    enum class Element : std::uint8_t
+        {
+        None,           // not configured; no flow is computed
+        Pitot,
+        Orifice,
+        Bypass,
+        };
+
+    struct Config
+        {
+        Element element;                /// the flow element
+        std::uint32_t KFactorQ16;       /// K, in Q16 (65536 is 1.0)
+        std::uint32_t AreaMm2;          /// duct or restriction area, mm^2
+        std::uint32_t AmbientPressurePa;    /// absolute pressure, for density
+        };
+
+    struct Flow
+        {
+        std::int32_t VolumeMilliLPerS;  /// volume flow, mL/s
+        std::int32_t MassMgPerS;        /// mass flow, mg/s
+        std::int32_t VelocityMmPerS;    /// velocity, mm/s (Pitot only, else 0)
+        std::uint32_t DensityMgPerM3;   /// density of air, mg/m^3
+        };
+
+    cSDPFlow() {}
+
+    // set the configuration. Returns false (leaving the configuration
+    // unchanged) if K is zero or over kMaxKFactorQ16, the area (where
+    // needed) is zero or over kMaxAreaMm2, or the pressure is outside
+    // kMinAmbientPressurePa to kMaxAmbientPressurePa; Element::None is
+    // always accepted.
+    bool configure(const Config &config);
+    const Config &getConfig() const
+        {
+        return this->m_config;
+        }
+    bool isEnabled() const
+        {
+        return this->m_config.element != Element::None;
+        }
+
+    // compute flow for one reading. Returns false if not configured.
+    bool compute(std::int32_t diffPressureMilliPa, std::int32_t temperatureMilliC, Flow &flow) const;
+
+    // density of dry air, in mg/m^3. The temperature and pressure are
+    // clamped to the limits above.
+    static std::uint32_t getAirDensity(std::int32_t temperatureMilliC, std::uint32_t pressurePa);
+
+    // velocity in um/s, given DP and density: sqrt(2 * DP / density),
+    // with the sign of DP. DP is clamped to +/- kMaxDiffPressureMilliPa,
+    // and the density must be from getAirDensity().
+    static std::int64_t getVelocityMicrons(std::int32_t diffPressureMilliPa, std::uint32_t densityMgPerM3);
+
+private:
+    Config m_config             /// the configuration
+        { Element::None, 65536, 0, kStandardPressurePa };
+    };
+
+} // namespace McciCatenaSdp
+
+#endif // _MCCI_CATENA_SDP_FLOW_H_
@@ -0,0 +1,157 @@
+/*
+
+Module: MCCI_Catena_SDP_Manager.cpp
+
+Function:
+    Implementation of cSDPManager, for several SDP sensors on one bus.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include <MCCI_Catena_SDP_Manager.h>
+
+using namespace McciCatenaSdp;
+
+bool cSDPManager::add(cSDP &sdp)
+    {
+    if (this->m_nSensors >= kMaxSensors)
+        return false;
+
+    if (sdp.getBus()->getBusId() != this->m_busId)
+        return false;
+
+    for (unsigned i = 0; i < this->m_nSensors; ++i)
+        {
+        if (this->m_pSensor[i] == &sdp ||
+            this->m_pSensor[i]->getAddressValue() == sdp.getAddressValue())
+            return false;
+        }
+
+    this->m_pSensor[this->m_nSensors++] = &sdp;
+    return true;
+    }
+
+bool cSDPManager::begin()
+    {
+    this->m_waking = this->m_triggered = this->m_ready = this->m_valid = 0;
+
+    // sensors that already started are left alone, so this can be called
+    // again to finish sensors that were waking up.
+    for (unsigned i = 0; i < this->m_nSensors; ++i)
+        {
+        const Mask_t bit = Mask_t(1u << i);
+
+        if (this->m_running & bit)
+            continue;
+
+        if (this->m_pSensor[i]->begin())
+            this->m_running |= bit;
+        else if (this->m_pSensor[i]->getLastError() == cSDP::Error::WakeupPending)
+            this->m_waking |= bit;
+        }
+
+    return this->m_running == Mask_t((1u << this->m_nSensors) - 1);
+    }
+
+void cSDPManager::end()
+    {
+    for (unsigned i = 0; i < this->m_nSensors; ++i)
+        this->m_pSensor[i]->end();
+
+    this->m_running = this->m_waking = this->m_triggered = this->m_ready = 0;
+    }
+
+bool cSDPManager::startTriggeredMeasurement()
+    {
+    this->m_waking = this->m_triggered = this->m_ready = 0;
+
+    // issue the triggers back-to-back so the conversions overlap.
+    for (unsigned i = 0; i < this->m_nSensors; ++i)
+        {
+        const Mask_t bit = Mask_t(1u << i);
+
+        if (this->m_running & bit)
+            this->trigger(i);
+        }
+
+    return (this->m_triggered | this->m_waking) != 0;
+    }
+
+// trigger sensor i; if it's still waking up, mark it to be tried again.
+void cSDPManager::trigger(unsigned i)
+    {
+    const Mask_t bit = Mask_t(1u << i);
+
+    this->m_waking &= ~bit;
+    if (this->m_pSensor[i]->startTriggeredMeasurement())
+        this->m_triggered |= bit;
+    else if (this->m_pSensor[i]->getLastError() == cSDP::Error::WakeupPending)
+        this->m_waking |= bit;
+    }
+
+bool cSDPManager::queryReady()
+    {
+    for (unsigned i = 0; i < this->m_nSensors; ++i)
+        {
+        const Mask_t bit = Mask_t(1u << i);
+
+        if (this->m_waking & bit)
+            this->trigger(i);
+
+        if (! (this->m_triggered & bit))
+            continue;
+
+        if (this->m_pSensor[i]->queryReady())
+            {
+            this->m_triggered &= ~bit;
+            this->m_ready |= bit;
+            }
+        else if (this->m_pSensor[i]->getLastError() != cSDP::Error::Busy)
+            {
+            // this one failed; don't wait for it.
+            this->m_triggered &= ~bit;
+            }
+        }
+
+    return (this->m_triggered | this->m_waking) == 0;
+    }
+
+cSDPManager::Mask_t cSDPManager::readMeasurements()
+    {
+    this->m_valid = 0;
+
+    for (unsigned i = 0; i < this->m_nSensors; ++i)
+        {
+        const Mask_t bit = Mask_t(1u << i);
+
+        if ((this->m_ready & bit) && this->m_pSensor[i]->readMeasurement())
+            this->m_valid |= bit;
+        }
+
+    this->m_ready = 0;
+    return this->m_valid;
+    }
+
+bool cSDPManager::sleep()
+    {
+    bool result = true;
+
+    for (unsigned i = 0; i < this->m_nSensors; ++i)
+        {
+        if (this->m_running & Mask_t(1u << i))
+            result = this->m_pSensor[i]->sleep() && result;
+        }
+
+    return result;
+    }
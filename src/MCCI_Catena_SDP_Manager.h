@@ -0,0 +1,117 @@
+/*
+
+Module: MCCI_Catena_SDP_Manager.h
+
+Function:
+    Manage several Sensirion SDP sensors sharing one I2C bus.
+
+Copyright and License:
+    See accompanying LICENSE file.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _MCCI_CATENA_SDP_MANAGER_H_
+# define _MCCI_CATENA_SDP_MANAGER_H_
+# pragma once
+
+#include <MCCI_Catena_SDP.h>
+
+namespace McciCatenaSdp {
+
+// manage a group of sensors on one bus, so that all of them convert at
+// the same time: trigger all back-to-back, then collect all the results
+// once the shared conversion window has elapsed.
+class cSDPManager
+    {
+public:
+    // maximum number of sensors: three SDP3x addresses plus the SDP8xx.
+    static constexpr unsigned kMaxSensors = 4;
+
+    // the type for sets of sensors; bit i represents sensor i.
+    using Mask_t = std::uint8_t;
+
+#if defined(ARDUINO)
+    cSDPManager(TwoWire &wire)
+        : m_busId(&wire)
+        {}
+#endif
+
+    cSDPManager(cBus &bus)
+        : m_busId(bus.getBusId())
+        {}
+
+    // neither copyable nor movable
+    cSDPManager(const cSDPManager&) = delete;
+    cSDPManager& operator=(const cSDPManager&) = delete;
+    cSDPManager(const cSDPManager&&) = delete;
+    cSDPManager& operator=(const cSDPManager&&) = delete;
+
+    // add a sensor; it must use this manager's bus, and have an address
+    // not already in use. Returns false if it can't be added.
+    bool add(cSDP &sdp);
+
+    // start all sensors. Returns true if all started; sensors that failed
+    // are omitted from subsequent measurements. If some sensors are still
+    // waking up (see getWakingMask()), call again later to finish them.
+    bool begin();
+    void end();
+
+    // trigger a measurement on each running sensor. Returns false if
+    // none could be started. Sensors that are still waking up are
+    // triggered by later calls to queryReady().
+    bool startTriggeredMeasurement();
+
+    // returns true when every triggered sensor has either finished or
+    // failed; false while any is still waking up or converting.
+    bool queryReady();
+
+    // read results from all sensors that are ready. Returns the set of
+    // sensors with valid new results.
+    Mask_t readMeasurements();
+
+    // put all sensors to sleep. Returns true if all succeeded.
+    bool sleep();
+
+    unsigned getCount() const
+        {
+        return this->m_nSensors;
+        }
+    cSDP *getSensor(unsigned i) const
+        {
+        return i < this->m_nSensors ? this->m_pSensor[i] : nullptr;
+        }
+    // sensors that passed begin()
+    Mask_t getRunningMask() const
+        {
+        return this->m_running;
+        }
+    // sensors whose begin() or trigger is waiting for wakeup
+    Mask_t getWakingMask() const
+        {
+        return this->m_waking;
+        }
+    // sensors with valid results from the last readMeasurements()
+    Mask_t getValidMask() const
+        {
+        return this->m_valid;
+        }
+
+private:
+    void trigger(unsigned i);
+
+    const void *m_busId;                    /// identifies the shared bus
+    cSDP *m_pSensor[kMaxSensors];           /// the sensors
+    std::uint8_t m_nSensors = 0;            /// number of entries in m_pSensor
+    Mask_t m_running = 0;                   /// sensors that passed begin()
+    Mask_t m_waking = 0;                    /// sensors still waking up
+    Mask_t m_triggered = 0;                 /// sensors still converting
+    Mask_t m_ready = 0;                     /// sensors with results to read
+    Mask_t m_valid = 0;                     /// sensors with valid results
+    };
+
+} // namespace McciCatenaSdp
+
+#endif // _MCCI_CATENA_SDP_MANAGER_H_
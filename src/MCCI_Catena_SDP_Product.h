@@ -0,0 +1,108 @@
+/*
+
+Module: MCCI_Catena_SDP_Product.h
+
+Function:
+    Compile-time specialization of the Catena SDP driver for one product.
+
+Copyright and License:
+    See accompanying LICENSE file.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _MCCI_CATENA_SDP_PRODUCT_H_
+# define _MCCI_CATENA_SDP_PRODUCT_H_
+# pragma once
+
+#include <MCCI_Catena_SDP.h>
+
+namespace McciCatenaSdp {
+
+// the properties of a product, as compile-time constants. These are used
+// directly by the driver steps (see cSDP::getProductOps()), so tests on
+// them fold away at compile time.
+template <cSDP::ProductId_t kId>
+struct cSDPProductTraits
+    {
+    static constexpr bool kFixed = true;
+    static constexpr cSDP::ProductId_t kProductId = kId;
+    static constexpr std::uint32_t kProductNumber = std::uint32_t(kId);
+    static constexpr cSDP::ProductFamily kFamily = cSDP::getProductFamily(kId);
+    static constexpr std::uint16_t kScale = cSDP::getProductScale(kId);
+    static constexpr std::uint32_t kTriggeredConversionMaxMs = cSDP::getTriggeredConversionMaxMs(kFamily);
+    // only the SDP3x has an IRQn pin.
+    static constexpr bool kHasAlert = kFamily == cSDP::ProductFamily::SDP3x;
+    static constexpr cSDP::Address kDefaultAddress =
+        kFamily == cSDP::ProductFamily::SDP8xx ? cSDP::Address::SDP8xx : cSDP::Address::SDP3x_A;
+
+    static_assert(kFamily != cSDP::ProductFamily::Unknown, "unknown product family");
+    static_assert(kScale != 0, "unknown product scale factor");
+
+    static constexpr bool isValidAddress(cSDP::Address address)
+        {
+        return cSDP::isValidAddress(kFamily, address);
+        }
+
+    static constexpr bool isExpectedProduct(std::uint32_t productNumber)
+        {
+        return productNumber == kProductNumber;
+        }
+
+    static constexpr std::uint32_t getConversionMaxMs(const cSDP &)
+        {
+        return kTriggeredConversionMaxMs;
+        }
+    };
+
+// a driver for one specific product. The scale factor, conversion time and
+// address are compile-time constants: the scale is not read from the
+// sensor, the first measurement can use any read profile, the address is
+// checked at compile time, and begin() fails with Error::ProductMismatch if
+// the attached sensor is a different product.
+template <cSDP::ProductId_t kId, cSDP::Address kAddress = cSDPProductTraits<kId>::kDefaultAddress>
+class cSDPProduct : public cSDP
+    {
+public:
+    using Traits = cSDPProductTraits<kId>;
+
+    static_assert(Traits::isValidAddress(kAddress), "address not supported by this product");
+
+#if defined(ARDUINO)
+    cSDPProduct(TwoWire &wire, Pin_t pinAlert = -1)
+        : cSDP(wire, kAddress, Traits::kHasAlert ? pinAlert : Pin_t(-1), getProductOps<Traits>())
+        {}
+#endif
+
+    cSDPProduct(cBus &bus, cClock &clock, Pin_t pinAlert = -1)
+        : cSDP(bus, clock, kAddress, Traits::kHasAlert ? pinAlert : Pin_t(-1), getProductOps<Traits>())
+        {}
+
+    static constexpr const char *getProductName()
+        {
+        return cSDP::getProductName(kId);
+        }
+
+    static constexpr ProductFamily getProductFamily()
+        {
+        return Traits::kFamily;
+        }
+
+    // convert raw DP to Pascals, using the constant scale factor.
+    static constexpr float rawDiffPtoPascal(std::int16_t diffP)
+        {
+        return float(diffP) / float(Traits::kScale);
+        }
+
+    // convert raw DP to milli-Pascals; the division is by a constant.
+    static constexpr std::int32_t rawDiffPtoMilliPascal(std::int16_t diffP)
+        {
+        return cSDP::rawDiffPtoMilliPascal(diffP, Traits::kScale);
+        }
+    };
+
+} // namespace McciCatenaSdp
+
+#endif // _MCCI_CATENA_SDP_PRODUCT_H_
@@ -0,0 +1,120 @@
+/*
+
+Module: MCCI_Catena_SDP_Series.cpp
+
+Function:
+    Compact delta encoding of sample series for the Catena SDP library.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include <MCCI_Catena_SDP_Series.h>
+
+using namespace McciCatenaSdp;
+
+std::size_t cDeltaSeries::putUvarint(std::uint8_t *pBuf, std::size_t nBuf, std::uint32_t v)
+    {
+    std::size_t n = 0;
+
+    do  {
+        if (n >= nBuf)
+            return 0;
+
+        std::uint8_t b = std::uint8_t(v & 0x7F);
+
+        v >>= 7;
+        if (v != 0)
+            b |= 0x80;
+        pBuf[n++] = b;
+        } while (v != 0);
+
+    return n;
+    }
+
+std::size_t cDeltaSeries::getUvarint(const std::uint8_t *pBuf, std::size_t nBuf, std::uint32_t &v)
+    {
+    std::uint32_t result = 0;
+
+    for (std::size_t n = 0; n < nBuf && n < kMaxVarintBytes; ++n)
+        {
+        const std::uint8_t b = pBuf[n];
+
+        result |= std::uint32_t(b & 0x7F) << (7 * n);
+        if ((b & 0x80) == 0)
+            {
+            v = result;
+            return n + 1;
+            }
+        }
+
+    return 0;
+    }
+
+// each value is coded relative to the previous quantized value, so
+// rounding errors don't accumulate along the series.
+std::size_t cDeltaSeries::encode(
+    const std::int32_t *pValues, std::size_t nValues,
+    std::uint32_t resolution,
+    std::uint8_t *pBuf, std::size_t nBuf,
+    std::size_t &nUsed
+    )
+    {
+    std::int32_t previous = 0;
+    std::size_t iValue;
+
+    nUsed = 0;
+    for (iValue = 0; iValue < nValues; ++iValue)
+        {
+        const std::int32_t q = quantize(pValues[iValue], resolution);
+        const std::size_t n = putUvarint(
+                                pBuf + nUsed, nBuf - nUsed,
+                                zigzag(std::int32_t(std::uint32_t(q) - std::uint32_t(previous)))
+                                );
+
+        if (n == 0)
+            break;
+
+        nUsed += n;
+        previous = q;
+        }
+
+    return iValue;
+    }
+
+std::size_t cDeltaSeries::decode(
+    const std::uint8_t *pBuf, std::size_t nBuf,
+    std::uint32_t resolution,
+    std::int32_t *pValues, std::size_t nValues,
+    std::size_t &nUsed
+    )
+    {
+    std::int32_t previous = 0;
+    std::size_t iValue;
+
+    nUsed = 0;
+    for (iValue = 0; iValue < nValues; ++iValue)
+        {
+        std::uint32_t u;
+        const std::size_t n = getUvarint(pBuf + nUsed, nBuf - nUsed, u);
+
+        if (n == 0)
+            break;
+
+        nUsed += n;
+        previous = std::int32_t(std::uint32_t(previous) + std::uint32_t(unzigzag(u)));
+        pValues[iValue] = std::int32_t(std::int64_t(previous) * resolution);
+        }
+
+    return iValue;
+    }
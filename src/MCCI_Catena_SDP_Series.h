@@ -0,0 +1,90 @@
+/*
+
+Module: MCCI_Catena_SDP_Series.h
+
+Function:
+    Compact delta encoding of sample series for the Catena SDP library.
+
+Copyright and License:
+    See accompanying LICENSE file.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _MCCI_CATENA_SDP_SERIES_H_
+# define _MCCI_CATENA_SDP_SERIES_H_
+# pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace McciCatenaSdp {
+
+// encode a series of integers (for example, DP in mPa, taken at regular
+// intervals) for an uplink: each value is first divided by the resolution,
+// rounding to nearest; then the first value is sent as a zigzag varint,
+// and each of the rest as the zigzag varint of its difference from the
+// one before. A slowly-varying series thus takes one byte per value.
+//
+// Varints are little-endian base 128: seven bits per byte, low-order
+// group first, with bit 7 set in every byte but the last. Zigzag maps
+// 0, -1, 1, -2, ... to 0, 1, 2, 3, ..., so small differences of either
+// sign give small varints.
+class cDeltaSeries
+    {
+public:
+    // the longest varint of a 32-bit value.
+    static constexpr std::size_t kMaxVarintBytes = 5;
+
+    static constexpr std::uint32_t zigzag(std::int32_t v)
+        {
+        return (std::uint32_t(v) << 1) ^ (v < 0 ? ~std::uint32_t(0) : 0);
+        }
+    static constexpr std::int32_t unzigzag(std::uint32_t u)
+        {
+        return std::int32_t(u >> 1) ^ -std::int32_t(u & 1);
+        }
+
+    // put v as a varint at pBuf; returns the number of bytes written, or
+    // zero if it doesn't fit in nBuf bytes.
+    static std::size_t putUvarint(std::uint8_t *pBuf, std::size_t nBuf, std::uint32_t v);
+    // get a varint from pBuf; returns the number of bytes used, or zero if
+    // the varint is truncated or too long.
+    static std::size_t getUvarint(const std::uint8_t *pBuf, std::size_t nBuf, std::uint32_t &v);
+
+    // encode as many of the nValues values at pValues as fit in nBuf bytes
+    // at pBuf, in units of resolution (which must be non-zero). Returns the
+    // number of values encoded; nUsed is set to the number of bytes used.
+    static std::size_t encode(
+        const std::int32_t *pValues, std::size_t nValues,
+        std::uint32_t resolution,
+        std::uint8_t *pBuf, std::size_t nBuf,
+        std::size_t &nUsed
+        );
+
+    // decode nValues values from the nBuf bytes at pBuf into pValues,
+    // multiplying by resolution. Returns the number of values decoded
+    // (less than nValues if the buffer is short); nUsed is set to the
+    // number of bytes used.
+    static std::size_t decode(
+        const std::uint8_t *pBuf, std::size_t nBuf,
+        std::uint32_t resolution,
+        std::int32_t *pValues, std::size_t nValues,
+        std::size_t &nUsed
+        );
+
+    // value / resolution, rounded half away from zero.
+    static std::int32_t quantize(std::int32_t value, std::uint32_t resolution)
+        {
+        const std::int64_t v = value;
+        const std::int64_t r = resolution;
+
+        return std::int32_t(v >= 0 ? (v + r / 2) / r : (v - r / 2) / r);
+        }
+    };
+
+} // namespace McciCatenaSdp
+
+#endif // _MCCI_CATENA_SDP_SERIES_H_
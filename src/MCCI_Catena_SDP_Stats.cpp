@@ -0,0 +1,249 @@
+/*
+
+Module: MCCI_Catena_SDP_Stats.cpp
+
+Function:
+    Integer running statistics for the Catena SDP library.
+
+Copyright and License:
+    This file copyright (C) 2020 by
+
+        MCCI Corporation
+        3520 Krums Corners Road
+        Ithaca, NY  14850
+
+    See accompanying LICENSE file for copyright and license information.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#include <MCCI_Catena_SDP_Stats.h>
+
+using namespace McciCatenaSdp;
+
+// bit-by-bit integer square root; no multiplies or divides, so it's
+// quick on a Cortex-M0+.
+std::uint32_t McciCatenaSdp::isqrt64(std::uint64_t v)
+    {
+    std::uint64_t result = 0;
+    std::uint64_t bit = std::uint64_t(1) << 62;
+
+    while (bit > v)
+        bit >>= 2;
+
+    while (bit != 0)
+        {
+        if (v >= result + bit)
+            {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+            }
+        else
+            result >>= 1;
+        bit >>= 2;
+        }
+
+    return std::uint32_t(result);
+    }
+
+void cRunningStats::add(std::int32_t v)
+    {
+    if (this->m_n == 0 && this->m_nIgnored == 0)
+        {
+        this->m_base = this->m_min = this->m_max = v;
+        this->m_sum = 0;
+        this->m_sumSq = 0;
+        }
+    else
+        {
+        if (v < this->m_min)
+            this->m_min = v;
+        if (v > this->m_max)
+            this->m_max = v;
+        }
+
+    const std::int64_t d = std::int64_t(v) - this->m_base;
+
+    if (this->m_n >= kMaxCount || d > kMaxSpread || d < -kMaxSpread)
+        {
+        ++this->m_nIgnored;
+        return;
+        }
+
+    this->m_sum += d;
+    this->m_sumSq += std::uint64_t(d * d);
+    ++this->m_n;
+    }
+
+std::int32_t cRunningStats::getMean() const
+    {
+    const std::int64_t n = this->m_n;
+
+    if (n == 0)
+        return 0;
+
+    // round half away from zero.
+    const std::int64_t sum = this->m_sum;
+    const std::int64_t mean = (sum >= 0) ? (sum + n / 2) / n : (sum - n / 2) / n;
+
+    return std::int32_t(this->m_base + mean);
+    }
+
+// the variance is (sumSq - sum^2 / n) / (n - 1). sum^2 might not fit in
+// 64 bits, so sum^2 / n is computed as sum * q + sum * r / n, where q and r
+// are the quotient and remainder of sum / n; both terms are non-negative.
+std::uint64_t cRunningStats::getVariance() const
+    {
+    const std::int64_t n = this->m_n;
+
+    if (n < 2)
+        return 0;
+
+    const std::int64_t sum = this->m_sum;
+    const std::int64_t q = sum / n;
+    const std::int64_t r = sum % n;
+    const std::uint64_t sumSqOverN = std::uint64_t(sum * q) + std::uint64_t((sum * r) / n);
+
+    if (sumSqOverN >= this->m_sumSq)
+        return 0;
+
+    return (this->m_sumSq - sumSqOverN) / std::uint64_t(n - 1);
+    }
+
+void cP2Quantile::setQuantile(std::uint16_t permille)
+    {
+    if (permille > 1000)
+        permille = 1000;
+
+    const std::uint32_t p = (std::uint32_t(permille) * 65536u + 500u) / 1000u;
+
+    this->m_permille = permille;
+    this->m_increment[0] = 0;
+    this->m_increment[1] = p / 2;
+    this->m_increment[2] = p;
+    this->m_increment[3] = (65536u + p) / 2;
+    this->m_increment[4] = 65536u;
+    this->clear();
+    }
+
+// num / den, rounded half away from zero; den must be positive.
+static std::int64_t divRound(std::int64_t num, std::int64_t den)
+    {
+    return (num >= 0) ? (num + den / 2) / den : (num - den / 2) / den;
+    }
+
+// the P^2 piecewise-parabolic prediction for marker i moved by s (+/- 1).
+std::int32_t cP2Quantile::parabolic(unsigned i, int s) const
+    {
+    const std::int64_t nLo = this->m_pos[i - 1];
+    const std::int64_t n = this->m_pos[i];
+    const std::int64_t nHi = this->m_pos[i + 1];
+    const std::int64_t qLo = this->m_height[i - 1];
+    const std::int64_t q = this->m_height[i];
+    const std::int64_t qHi = this->m_height[i + 1];
+
+    const std::int64_t a = divRound((n - nLo + s) * (qHi - q), nHi - n);
+    const std::int64_t b = divRound((nHi - n - s) * (q - qLo), n - nLo);
+
+    return std::int32_t(q + divRound(s * (a + b), nHi - nLo));
+    }
+
+std::int32_t cP2Quantile::linear(unsigned i, int s) const
+    {
+    const std::int64_t q = this->m_height[i];
+    const std::int64_t dq = std::int64_t(this->m_height[i + s]) - q;
+    const std::int64_t dn = std::int64_t(this->m_pos[i + s]) - this->m_pos[i];
+
+    return std::int32_t(q + divRound(dq, dn));
+    }
+
+void cP2Quantile::add(std::int32_t v)
+    {
+    auto const q = this->m_height;
+    auto const pos = this->m_pos;
+
+    if (this->m_n >= kMaxCount)
+        return;
+
+    // the first values are kept, sorted; they become the markers.
+    if (this->m_n < kMarkers)
+        {
+        unsigned i = this->m_n;
+
+        for (; i > 0 && q[i - 1] > v; --i)
+            q[i] = q[i - 1];
+        q[i] = v;
+
+        ++this->m_n;
+        if (this->m_n == kMarkers)
+            {
+            for (unsigned j = 0; j < kMarkers; ++j)
+                pos[j] = std::uint16_t(j + 1);
+            }
+        return;
+        }
+
+    // find the cell k such that q[k] <= v < q[k + 1], extending the
+    // extreme markers if needed, and move the markers above it.
+    unsigned k;
+
+    if (v < q[0])
+        {
+        q[0] = v;
+        k = 0;
+        }
+    else if (v >= q[kMarkers - 1])
+        {
+        q[kMarkers - 1] = v;
+        k = kMarkers - 2;
+        }
+    else
+        {
+        for (k = 0; v >= q[k + 1]; ++k)
+            /* nothing */;
+        }
+
+    for (unsigned i = k + 1; i < kMarkers; ++i)
+        ++pos[i];
+
+    ++this->m_n;
+
+    // adjust the inner markers that are at least one position away from
+    // where they should be, if there's room to move.
+    for (unsigned i = 1; i < kMarkers - 1; ++i)
+        {
+        const std::int64_t d = this->desiredPosition(i) - (std::int64_t(pos[i]) << 16);
+        int s;
+
+        if (d >= (std::int64_t(1) << 16) && pos[i + 1] - pos[i] > 1)
+            s = 1;
+        else if (d <= -(std::int64_t(1) << 16) && pos[i - 1] - pos[i] < -1)
+            s = -1;
+        else
+            continue;
+
+        std::int32_t qNew = this->parabolic(i, s);
+
+        if (! (q[i - 1] < qNew && qNew < q[i + 1]))
+            qNew = this->linear(i, s);
+
+        q[i] = qNew;
+        pos[i] = std::uint16_t(pos[i] + s);
+        }
+    }
+
+std::int32_t cP2Quantile::getEstimate() const
+    {
+    const std::uint32_t n = this->m_n;
+
+    if (n == 0)
+        return 0;
+
+    // with few values, they're all on hand: use the nearest rank.
+    if (n < kMarkers)
+        return this->m_height[(std::uint32_t(this->m_permille) * (n - 1) + 500u) / 1000u];
+
+    return this->m_height[2];
+    }
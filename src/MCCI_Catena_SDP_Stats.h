@@ -0,0 +1,156 @@
+/*
+
+Module: MCCI_Catena_SDP_Stats.h
+
+Function:
+    Integer running statistics for the Catena SDP library.
+
+Copyright and License:
+    See accompanying LICENSE file.
+
+Author:
+    Terry Moore, MCCI Corporation   September 2020
+
+*/
+
+#ifndef _MCCI_CATENA_SDP_STATS_H_
+# define _MCCI_CATENA_SDP_STATS_H_
+# pragma once
+
+#include <cstdint>
+
+namespace McciCatenaSdp {
+
+// integer square root: the largest r such that r * r <= v.
+std::uint32_t isqrt64(std::uint64_t v);
+
+// running count, mean, variance, minimum and maximum of a stream of
+// integers (for example, DP in mPa), in constant space and without
+// floating point.
+//
+// Values are accumulated as sums of differences from the first value,
+// so the sums stay small for the usual case of a stream that doesn't
+// wander far, and the variance is computed exactly in integer arithmetic:
+// there is no cancellation error, unlike the float sum-of-squares method.
+// Differences from the first value must be within +/- kMaxSpread; after
+// kMaxCount values, further values only update the minimum and maximum.
+class cRunningStats
+    {
+public:
+    static constexpr std::int32_t kMaxSpread = (1 << 23) - 1;
+    static constexpr std::uint32_t kMaxCount = 0xFFFF;
+
+    void clear()
+        {
+        this->m_n = 0;
+        this->m_nIgnored = 0;
+        }
+    void add(std::int32_t v);
+
+    // number of values accumulated
+    std::uint32_t getCount() const
+        {
+        return this->m_n;
+        }
+    // number of values not included in mean and variance
+    std::uint32_t getIgnoredCount() const
+        {
+        return this->m_nIgnored;
+        }
+    std::int32_t getMin() const
+        {
+        return this->m_n == 0 ? 0 : this->m_min;
+        }
+    std::int32_t getMax() const
+        {
+        return this->m_n == 0 ? 0 : this->m_max;
+        }
+    // the mean, rounded to nearest.
+    std::int32_t getMean() const;
+    // the sample variance (divided by n - 1), rounded down; zero if fewer
+    // than two values.
+    std::uint64_t getVariance() const;
+    // the sample standard deviation, rounded down.
+    std::uint32_t getStdDev() const
+        {
+        return isqrt64(this->getVariance());
+        }
+
+private:
+    std::int64_t m_sum;         /// sum of (v - m_base)
+    std::uint64_t m_sumSq;      /// sum of (v - m_base)^2
+    std::int32_t m_base;        /// first value
+    std::int32_t m_min;         /// smallest value
+    std::int32_t m_max;         /// largest value
+    std::uint32_t m_n           /// number of values
+        { 0 };
+    std::uint32_t m_nIgnored    /// values outside kMaxSpread or beyond kMaxCount
+        { 0 };
+    };
+
+// streaming estimate of one quantile (for example, the median or the 95th
+// percentile) of a stream of integers, in constant space, using the P^2
+// algorithm of Jain and Chlamtac (CACM 28:10, 1985). Five markers track the
+// minimum, the quantile, the quantile's neighbours half-way to each end,
+// and the maximum; as values arrive, the inner markers are moved towards
+// their desired positions, adjusting their heights by piecewise-parabolic
+// interpolation. Until five values have arrived, the result is exact.
+//
+// The arithmetic is integer; heights are rounded to the nearest unit of
+// the input, and the desired positions are kept in Q16. After kMaxCount
+// values, further values are ignored.
+class cP2Quantile
+    {
+public:
+    static constexpr std::uint32_t kMaxCount = 0xFFFF;
+    static constexpr unsigned kMarkers = 5;
+
+    // the quantile is given in permille: 500 is the median, 950 the 95th
+    // percentile. Values over 1000 are taken as 1000.
+    cP2Quantile(std::uint16_t permille = 500)
+        {
+        this->setQuantile(permille);
+        }
+
+    // set the quantile to be estimated, and clear.
+    void setQuantile(std::uint16_t permille);
+    std::uint16_t getQuantile() const
+        {
+        return this->m_permille;
+        }
+
+    void clear()
+        {
+        this->m_n = 0;
+        }
+    void add(std::int32_t v);
+
+    // number of values accumulated
+    std::uint32_t getCount() const
+        {
+        return this->m_n;
+        }
+    // the estimate of the quantile; zero if no values have been added.
+    std::int32_t getEstimate() const;
+
+private:
+    // desired position of marker i, 1-origin, in Q16.
+    std::int64_t desiredPosition(unsigned i) const
+        {
+        return (std::int64_t(1) << 16) +
+               std::int64_t(this->m_n - 1) * this->m_increment[i];
+        }
+    std::int32_t parabolic(unsigned i, int s) const;
+    std::int32_t linear(unsigned i, int s) const;
+
+    std::int32_t m_height[kMarkers];    /// marker heights (sorted values until m_n == kMarkers)
+    std::uint16_t m_pos[kMarkers];      /// marker positions, 1-origin
+    std::uint32_t m_increment[kMarkers];    /// increment of desired positions per value, Q16
+    std::uint32_t m_n                   /// number of values
+        { 0 };
+    std::uint16_t m_permille;           /// the quantile, in permille
+    };
+
+} // namespace McciCatenaSdp
+
+#endif // _MCCI_CATENA_SDP_STATS_H_